@@ -0,0 +1,374 @@
+#pragma once
+
+// Engine processes and games, shared by match_runner.cpp and spsa_tuner.cpp.
+//
+// An EngineProcess runs a UCI engine in its own directory (where it finds weights.txt and its
+// books) behind a pair of pipes. playGame() plays one game between two of them with clocks kept
+// by the caller's side on a monotonic clock: an engine that overruns its clock by more than the
+// margin, crashes, or plays an illegal move loses the game and is restarted for the next one.
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../../chess-library/include/chess.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+constexpr long HANDSHAKE_MS = 10000;   // For uciok and readyok
+
+struct TimeControl {
+    long baseMs = 10000;    // Clock at the start of the game
+    long incMs = 100;       // Added after each move
+    long marginMs = 100;    // Overrun tolerated before a game is lost on time
+    int maxPlies = 400;     // Longer games are adjudicated as draws
+};
+
+// "base+inc" in seconds, e.g. "10+0.1"
+inline void parseTimeControl(const std::string& text, TimeControl& tc) {
+    size_t plus = text.find('+');
+    tc.baseMs = static_cast<long>(std::stod(text.substr(0, plus)) * 1000);
+    tc.incMs = plus == std::string::npos ? 0 : static_cast<long>(std::stod(text.substr(plus + 1)) * 1000);
+}
+
+// Short, balanced openings; each is played once with each color
+inline const std::vector<std::string> DEFAULT_OPENINGS = {
+    "e2e4 e7e5 g1f3 b8c6 f1b5",
+    "e2e4 e7e5 g1f3 b8c6 f1c4",
+    "e2e4 c7c5 g1f3 d7d6",
+    "e2e4 c7c5 b1c3 b8c6",
+    "e2e4 e7e6 d2d4 d7d5",
+    "e2e4 c7c6 d2d4 d7d5",
+    "e2e4 d7d5 e4d5 d8d5",
+    "e2e4 g7g6 d2d4 f8g7",
+    "d2d4 d7d5 c2c4 e7e6",
+    "d2d4 d7d5 c2c4 c7c6",
+    "d2d4 g8f6 c2c4 g7g6",
+    "d2d4 g8f6 c2c4 e7e6",
+    "d2d4 g8f6 g1f3 d7d5",
+    "d2d4 f7f5 g2g3 g8f6",
+    "c2c4 e7e5 b1c3 g8f6",
+    "c2c4 c7c5 g1f3 g8f6",
+    "g1f3 d7d5 g2g3 g8f6",
+    "g1f3 g8f6 c2c4 c7c5",
+    "e2e4 e7e5 f2f4 e5f4",
+    "d2d4 d7d5 c1f4 g8f6",
+};
+
+//-------------------------------------------------------------
+// Engine processes
+//-------------------------------------------------------------
+
+class EngineProcess {
+public:
+    EngineProcess(const std::string& path) : path(path) {}
+    ~EngineProcess() { stop(); }
+
+    // Start the process in the engine's directory, wait for uciok, send the options set so far
+    // and wait for readyok
+    bool start() {
+        stop();
+        int toEngine[2], fromEngine[2];
+        if (pipe2(toEngine, O_CLOEXEC) || pipe2(fromEngine, O_CLOEXEC)) return false;
+        pid = fork();
+        if (pid == 0) {
+            dup2(toEngine[0], STDIN_FILENO);
+            dup2(fromEngine[1], STDOUT_FILENO);
+            int devNull = open("/dev/null", O_WRONLY);
+            if (devNull >= 0) dup2(devNull, STDERR_FILENO);   // Debug output is not UCI
+            size_t slash = path.rfind('/');
+            if (slash != std::string::npos && chdir(path.substr(0, slash).c_str()) != 0) _exit(127);
+            std::string program = slash == std::string::npos ? path : "./" + path.substr(slash + 1);
+            execl(program.c_str(), program.c_str(), static_cast<char*>(nullptr));
+            _exit(127);
+        }
+        close(toEngine[0]);
+        close(fromEngine[1]);
+        if (pid < 0) {
+            close(toEngine[1]);
+            close(fromEngine[0]);
+            return false;
+        }
+        in = toEngine[1];
+        out = fromEngine[0];
+        eof = false;
+        buffer.clear();
+
+        send("uci");
+        if (!waitFor("uciok", Clock::now() + std::chrono::milliseconds(HANDSHAKE_MS))) return false;
+        for (const auto& [name, value] : options) send("setoption name " + name + " value " + value);
+        return ready();
+    }
+
+    bool ready() {
+        send("isready");
+        return waitFor("readyok", Clock::now() + std::chrono::milliseconds(HANDSHAKE_MS));
+    }
+
+    void stop() {
+        if (pid <= 0) return;
+        send("quit");
+        close(in);
+        close(out);
+        // Give it a moment to leave on its own, then kill it
+        for (int i = 0; i < 20 && waitpid(pid, nullptr, WNOHANG) == 0; ++i)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        if (waitpid(pid, nullptr, WNOHANG) == 0) {
+            kill(pid, SIGKILL);
+            waitpid(pid, nullptr, 0);
+        }
+        pid = -1;
+    }
+
+    bool alive() const { return pid > 0 && !eof; }
+
+    void send(const std::string& line) {
+        std::string data = line + "\n";
+        if (write(in, data.data(), data.size()) != static_cast<ssize_t>(data.size())) eof = true;
+    }
+
+    // Sent now if the engine runs, and again whenever it is restarted
+    void setOption(const std::string& name, const std::string& value) {
+        auto it = std::find_if(options.begin(), options.end(), [&](const auto& option) { return option.first == name; });
+        if (it != options.end()) it->second = value;
+        else options.emplace_back(name, value);
+        if (alive()) send("setoption name " + name + " value " + value);
+    }
+
+    // Next output line; false at the deadline or when the engine is gone
+    bool readLine(std::string& line, Clock::time_point deadline) {
+        while (true) {
+            size_t end = buffer.find('\n');
+            if (end != std::string::npos) {
+                line = buffer.substr(0, end);
+                if (!line.empty() && line.back() == '\r') line.pop_back();
+                buffer.erase(0, end + 1);
+                return true;
+            }
+            long wait = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+            if (wait <= 0) return false;
+            pollfd fd = {out, POLLIN, 0};
+            int ready = poll(&fd, 1, static_cast<int>(std::min(wait, 1000L)));
+            if (ready <= 0) continue;
+            char chunk[4096];
+            ssize_t n = read(out, chunk, sizeof(chunk));
+            if (n <= 0) {
+                eof = true;
+                return false;
+            }
+            buffer.append(chunk, n);
+        }
+    }
+
+    bool waitFor(const std::string& prefix, Clock::time_point deadline, std::string* found = nullptr) {
+        std::string line;
+        while (readLine(line, deadline)) {
+            if (line.compare(0, prefix.size(), prefix) == 0) {
+                if (found) *found = line;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::string name() const {
+        size_t slash = path.rfind('/');
+        return slash == std::string::npos ? path : path.substr(slash + 1);
+    }
+
+private:
+    std::string path;
+    pid_t pid = -1;
+    int in = -1, out = -1;
+    bool eof = false;
+    std::string buffer;
+    std::vector<std::pair<std::string, std::string>> options;
+};
+
+//-------------------------------------------------------------
+// Games
+//-------------------------------------------------------------
+
+struct Opening {
+    std::string fen;                // Empty for the standard start position
+    std::vector<std::string> moves; // UCI moves played before the engines take over
+};
+
+struct GameRecord {
+    std::string white, black;
+    Opening opening;
+    std::vector<chess::Move> moves; // Opening moves included
+    std::string result = "*";       // "1-0", "0-1" or "1/2-1/2"
+    std::string termination;
+};
+
+// Play one game; `engines[0]` has white. An engine that crashes or times out is restarted.
+inline GameRecord playGame(EngineProcess* engines[2], const Opening& opening, const TimeControl& tc) {
+    using namespace chess;
+    GameRecord game;
+    game.white = engines[0]->name();
+    game.black = engines[1]->name();
+    game.opening = opening;
+
+    Board board = opening.fen.empty() ? Board() : Board(opening.fen);
+    std::string position = opening.fen.empty() ? "position startpos moves" : "position fen " + opening.fen + " moves";
+    for (const auto& text : opening.moves) {
+        Move move = uci::uciToMove(board, text);
+        board.makeMove(move);
+        game.moves.push_back(move);
+        position += " " + text;
+    }
+
+    for (int side = 0; side < 2; ++side) {
+        if (!engines[side]->alive()) engines[side]->start();
+        engines[side]->send("ucinewgame");
+        engines[side]->ready();
+    }
+
+    long clock[2] = {tc.baseMs, tc.baseMs};
+    auto finish = [&](int winner, const std::string& why) {
+        game.result = winner < 0 ? "1/2-1/2" : (winner == 0 ? "1-0" : "0-1");
+        game.termination = why;
+    };
+
+    while (true) {
+        auto [reason, outcome] = board.isGameOver();
+        if (reason != GameResultReason::NONE) {
+            int stm = board.sideToMove() == Color::WHITE ? 0 : 1;
+            if (outcome == GameResult::LOSE) finish(1 - stm, "checkmate");
+            else if (reason == GameResultReason::STALEMATE) finish(-1, "stalemate");
+            else if (reason == GameResultReason::INSUFFICIENT_MATERIAL) finish(-1, "insufficient material");
+            else if (reason == GameResultReason::FIFTY_MOVE_RULE) finish(-1, "fifty move rule");
+            else finish(-1, "threefold repetition");
+            break;
+        }
+        if (static_cast<int>(game.moves.size()) >= tc.maxPlies) {
+            finish(-1, "adjudicated after " + std::to_string(tc.maxPlies) + " plies");
+            break;
+        }
+
+        int side = board.sideToMove() == Color::WHITE ? 0 : 1;
+        EngineProcess& engine = *engines[side];
+        engine.send(position);
+        std::ostringstream go;
+        go << "go wtime " << std::max(0L, clock[0]) << " btime " << std::max(0L, clock[1]) << " winc " << tc.incMs
+           << " binc " << tc.incMs;
+        engine.send(go.str());
+
+        auto start = Clock::now();
+        std::string line;
+        bool answered = engine.waitFor("bestmove", start + std::chrono::milliseconds(clock[side] + tc.marginMs), &line);
+        long used = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count();
+
+        if (!answered) {
+            finish(1 - side, engine.name() + (engine.alive() ? " lost on time" : " crashed"));
+            engine.stop();   // Restarted for the next game
+            break;
+        }
+        clock[side] -= used;
+        if (clock[side] < -tc.marginMs) {
+            finish(1 - side, engine.name() + " lost on time");
+            break;
+        }
+        clock[side] += tc.incMs;
+
+        std::istringstream reply(line);
+        std::string token, text;
+        reply >> token >> text;
+        Move move = uci::uciToMove(board, text);
+        Movelist legal;
+        movegen::legalmoves(legal, board);
+        if (move == Move::NO_MOVE || std::find(legal.begin(), legal.end(), move) == legal.end()) {
+            finish(1 - side, "illegal move " + text);
+            break;
+        }
+        board.makeMove(move);
+        game.moves.push_back(move);
+        position += " " + text;
+    }
+    return game;
+}
+
+inline void writePgn(std::ostream& out, const GameRecord& game, int round, const TimeControl& tc) {
+    using namespace chess;
+    char date[16];
+    time_t now = time(nullptr);
+    strftime(date, sizeof(date), "%Y.%m.%d", localtime(&now));
+    out << "[Event \"Chessape match\"]\n[Site \"local\"]\n[Date \"" << date << "\"]\n[Round \"" << round << "\"]\n"
+        << "[White \"" << game.white << "\"]\n[Black \"" << game.black << "\"]\n[Result \"" << game.result << "\"]\n"
+        << "[TimeControl \"" << tc.baseMs / 1000.0 << "+" << tc.incMs / 1000.0 << "\"]\n"
+        << "[Termination \"" << game.termination << "\"]\n";
+    if (!game.opening.fen.empty()) out << "[SetUp \"1\"]\n[FEN \"" << game.opening.fen << "\"]\n";
+    out << "\n";
+
+    Board board = game.opening.fen.empty() ? Board() : Board(game.opening.fen);
+    size_t column = 0;
+    for (const Move& move : game.moves) {
+        std::string text;
+        if (board.sideToMove() == Color::WHITE) text = std::to_string(board.fullMoveNumber()) + ". ";
+        else if (column == 0) text = std::to_string(board.fullMoveNumber()) + "... ";
+        text += uci::moveToSan(board, move) + " ";
+        board.makeMove(move);
+        if (column + text.size() > 80) {
+            out << "\n";
+            column = 0;
+        }
+        out << text;
+        column += text.size();
+    }
+    out << game.result << "\n\n";
+    out.flush();
+}
+
+// The default openings when `path` is empty, otherwise one opening per line: a FEN or EPD
+// (4 to 6 fields), or UCI moves from the start position
+inline std::vector<Opening> loadOpenings(const std::string& path) {
+    std::vector<Opening> openings;
+    if (path.empty()) {
+        for (const auto& line : DEFAULT_OPENINGS) {
+            Opening opening;
+            std::istringstream moves(line);
+            std::string move;
+            while (moves >> move) opening.moves.push_back(move);
+            openings.push_back(opening);
+        }
+        return openings;
+    }
+    std::ifstream in(path);
+    std::string line;
+    while (getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        Opening opening;
+        std::istringstream fields(line);
+        std::string field;
+        if (line.find('/') != std::string::npos) {
+            // EPD lines have operations where the move counters would be: those stop the FEN
+            std::vector<std::string> parts;
+            while (parts.size() < 6 && fields >> field) {
+                if (parts.size() >= 4 && !std::all_of(field.begin(), field.end(), ::isdigit)) break;
+                parts.push_back(field);
+            }
+            if (parts.size() < 4) continue;
+            if (parts.size() < 5) parts.push_back("0");
+            if (parts.size() < 6) parts.push_back("1");
+            for (size_t i = 0; i < parts.size(); ++i) opening.fen += (i ? " " : "") + parts[i];
+        }
+        else while (fields >> field) opening.moves.push_back(field);
+        openings.push_back(opening);
+    }
+    return openings;
+}
@@ -0,0 +1,189 @@
+// Match runner: plays concurrent games between two UCI engines and reports Elo and SPRT live.
+//
+// Build:  g++ -std=c++17 -O3 -march=native -pthread -o match_runner match_runner.cpp
+// Usage:  ./match_runner -e1 ../Models/bin/Chessape_2.0 -e2 ../Models/bin/Chessape_1.2
+//                        [-g games] [-c concurrency] [--tc base+inc] [--margin ms]
+//                        [--openings file] [--pgn games.pgn] [--sprt elo0 elo1 [alpha beta]]
+//                        [--max-plies N]
+//
+// Each of the `concurrency` workers owns one process of each engine (started in the engine's
+// directory, where it finds weights.txt and its books) and plays game pairs: every opening is
+// played twice with colors swapped. Clocks are kept by the runner with a monotonic clock; an
+// engine that overruns its clock by more than the margin, crashes, or plays an illegal move
+// loses the game and is restarted. Every finished game is appended to the PGN file and
+// updates the W/L/D, Elo with 95% error bars and, with --sprt, the log likelihood ratio.
+// The run ends after the given number of games or when the SPRT accepts a hypothesis.
+
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <fstream>
+#include <algorithm>
+#include <iomanip>
+
+#include "match.h"
+
+using namespace chess;
+using namespace std;
+
+// Configuration values (overridable from the command line)
+int GAMES = 100;
+int CONCURRENCY = max(1u, thread::hardware_concurrency());
+TimeControl TC;
+
+//-------------------------------------------------------------
+// Statistics
+//-------------------------------------------------------------
+
+double expectedScore(double elo) {
+    return 1.0 / (1.0 + pow(10.0, -elo / 400.0));
+}
+
+double scoreToElo(double score) {
+    score = min(max(score, 1e-6), 1.0 - 1e-6);
+    return -400.0 * log10(1.0 / score - 1.0);
+}
+
+struct Tally {
+    int wins = 0, losses = 0, draws = 0;   // From the first engine's point of view
+
+    int games() const { return wins + losses + draws; }
+    double score() const { return games() ? (wins + 0.5 * draws) / games() : 0.5; }
+    // Variance of one game's score
+    double variance() const {
+        if (!games()) return 0;
+        double s = score();
+        return (wins * (1 - s) * (1 - s) + draws * (0.5 - s) * (0.5 - s) + losses * s * s) / games();
+    }
+    // Elo and the half width of its 95% interval
+    pair<double, double> elo() const {
+        double margin = games() ? 1.96 * sqrt(variance() / games()) : 0;
+        double low = scoreToElo(score() - margin), high = scoreToElo(score() + margin);
+        return {scoreToElo(score()), (high - low) / 2};
+    }
+    // Log likelihood ratio of elo1 against elo0 (normal approximation of the trinomial model)
+    double llr(double elo0, double elo1) const {
+        double var = variance();
+        if (!games() || var <= 0) return 0;
+        double s0 = expectedScore(elo0), s1 = expectedScore(elo1);
+        return games() * (s1 - s0) * (2 * score() - s0 - s1) / (2 * var);
+    }
+};
+
+int main(int argc, char* argv[]) {
+    string engine1, engine2, openingsPath, pgnPath = "match.pgn";
+    bool sprt = false;
+    double elo0 = 0, elo1 = 5, alpha = 0.05, beta = 0.05;
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        auto number = [&](int k) {
+            if (i + k >= argc) return false;
+            char* end;
+            strtod(argv[i + k], &end);
+            return end != argv[i + k] && *end == '\0';
+        };
+        if (arg == "-e1" && i + 1 < argc) engine1 = argv[++i];
+        else if (arg == "-e2" && i + 1 < argc) engine2 = argv[++i];
+        else if ((arg == "-g" || arg == "--games") && i + 1 < argc) GAMES = max(1, stoi(argv[++i]));
+        else if ((arg == "-c" || arg == "--concurrency") && i + 1 < argc) CONCURRENCY = max(1, stoi(argv[++i]));
+        else if (arg == "--tc" && i + 1 < argc) {
+            parseTimeControl(argv[++i], TC);
+        }
+        else if (arg == "--margin" && i + 1 < argc) TC.marginMs = stol(argv[++i]);
+        else if (arg == "--max-plies" && i + 1 < argc) TC.maxPlies = stoi(argv[++i]);
+        else if (arg == "--openings" && i + 1 < argc) openingsPath = argv[++i];
+        else if (arg == "--pgn" && i + 1 < argc) pgnPath = argv[++i];
+        else if (arg == "--sprt" && number(1) && number(2)) {
+            sprt = true;
+            elo0 = stod(argv[++i]);
+            elo1 = stod(argv[++i]);
+            if (number(1) && number(2)) {
+                alpha = stod(argv[++i]);
+                beta = stod(argv[++i]);
+            }
+        }
+        else {
+            cerr << "Unknown argument " << arg << endl;
+            return 1;
+        }
+    }
+    if (engine1.empty() || engine2.empty()) {
+        cerr << "Usage: " << argv[0] << " -e1 engine1 -e2 engine2 [-g games] [-c concurrency] [--tc base+inc] [--margin ms]"
+             << " [--openings file] [--pgn games.pgn] [--sprt elo0 elo1 [alpha beta]] [--max-plies N]" << endl;
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);   // A crashed engine must not take the runner with it
+
+    vector<Opening> openings = loadOpenings(openingsPath);
+    if (openings.empty()) {
+        cerr << "No openings in " << openingsPath << endl;
+        return 1;
+    }
+
+    double lower = log(beta / (1 - alpha)), upper = log((1 - beta) / alpha);
+    ofstream pgn(pgnPath, ios::app);
+    mutex results_mutex;
+    Tally tally;
+    atomic<int> next{0};
+    atomic<bool> stopRun{false};
+    auto start = Clock::now();
+
+    cout << "Match " << engine1 << " vs " << engine2 << ": " << GAMES << " games, tc " << TC.baseMs / 1000.0 << "+"
+         << TC.incMs / 1000.0 << ", " << CONCURRENCY << " concurrent, " << openings.size() << " openings" << endl;
+
+    auto worker = [&]() {
+        EngineProcess first(engine1), second(engine2);
+        for (int game = next++; game < GAMES && !stopRun; game = next++) {
+            // Game 2k and 2k+1 share an opening, with colors swapped
+            const Opening& opening = openings[(game / 2) % openings.size()];
+            bool firstIsWhite = game % 2 == 0;
+            EngineProcess* engines[2] = {firstIsWhite ? &first : &second, firstIsWhite ? &second : &first};
+            GameRecord record = playGame(engines, opening, TC);
+
+            lock_guard<mutex> lock(results_mutex);
+            if (record.result == "1/2-1/2") ++tally.draws;
+            else if ((record.result == "1-0") == firstIsWhite) ++tally.wins;
+            else ++tally.losses;
+            writePgn(pgn, record, game + 1, TC);
+
+            auto [elo, error] = tally.elo();
+            cout << fixed << setprecision(1) << "Game " << setw(4) << tally.games() << " (" << record.white << " - "
+                 << record.black << " " << record.result << ", " << record.termination << "): +" << tally.wins << " -"
+                 << tally.losses << " =" << tally.draws << "  score " << 100 * tally.score() << "%  Elo " << elo
+                 << " +/- " << error;
+            if (sprt) {
+                double llr = tally.llr(elo0, elo1);
+                cout << setprecision(2) << "  LLR " << llr << " [" << lower << ", " << upper << "]";
+                if (llr >= upper || llr <= lower) stopRun = true;
+            }
+            cout << endl;
+        }
+    };
+
+    vector<thread> workers;
+    for (int i = 0; i < CONCURRENCY; ++i) workers.emplace_back(worker);
+    for (auto& t : workers) t.join();
+
+    long elapsed = chrono::duration_cast<chrono::seconds>(Clock::now() - start).count();
+    auto [elo, error] = tally.elo();
+    cout << "===========================" << endl;
+    cout << "Games            : " << tally.games() << " (+" << tally.wins << " -" << tally.losses << " =" << tally.draws << ")" << endl;
+    cout << "Score            : " << fixed << setprecision(1) << 100 * tally.score() << "%" << endl;
+    cout << "Elo difference   : " << elo << " +/- " << error << " (95%)" << endl;
+    if (sprt) {
+        double llr = tally.llr(elo0, elo1);
+        cout << "SPRT             : elo0 " << elo0 << ", elo1 " << elo1 << ", LLR " << setprecision(2) << llr << " ["
+             << lower << ", " << upper << "] "
+             << (llr >= upper ? "H1 accepted" : llr <= lower ? "H0 accepted" : "inconclusive") << endl;
+    }
+    cout << "Time (s)         : " << elapsed << endl;
+    cout << "PGN              : " << pgnPath << endl;
+    return 0;
+}
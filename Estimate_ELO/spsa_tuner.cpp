@@ -0,0 +1,187 @@
+// SPSA tuner: tunes engine parameters exposed as UCI options by playing fast self-play games.
+//
+// Build:  g++ -std=c++17 -O3 -march=native -pthread -o spsa_tuner spsa_tuner.cpp
+// Usage:  ./spsa_tuner -e ../Models/bin/Chessape_2.0 [-p spsa_params.txt] [-i iterations]
+//                      [-c concurrency] [--tc base+inc] [--margin ms] [--openings file]
+//                      [-o spsa_result.txt] [--seed N]
+//
+// Parameters file, one per line:  name start min max c_end r_end
+//   c_end is the perturbation at the last iteration: a change about the size that makes a
+//   small but measurable difference. r_end is the learning rate at the last iteration; 0.002
+//   is the usual choice. Lines starting with '#' are comments.
+//
+// Simultaneous perturbation stochastic approximation, with the gain schedules used by
+// fishtest: every iteration perturbs all parameters at once by +/-c_k (random signs), plays a
+// game pair (one opening, colors swapped) between the engine at theta+ and at theta-, and moves
+// theta by a_k/c_k * (wins - losses of theta+) in the perturbation's direction. Each of the
+// `concurrency` workers owns two engine processes and runs iterations on its own; updates are
+// applied as the pairs finish. Values are set with setoption before each pair, so the engine
+// is never rebuilt or restarted. The current values are written in config.txt format to the
+// output file after every iteration.
+
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <fstream>
+#include <algorithm>
+#include <iomanip>
+#include <random>
+
+#include "match.h"
+
+using namespace std;
+
+// Configuration values (overridable from the command line)
+int ITERATIONS = 1000;      // Game pairs
+int CONCURRENCY = max(1u, thread::hardware_concurrency());
+TimeControl TC = {2000, 20, 100, 300};
+constexpr double ALPHA = 0.602;     // Decay of the learning rate
+constexpr double GAMMA = 0.101;     // Decay of the perturbation
+
+struct Parameter {
+    string name;
+    double value, min, max;
+    double c, a;    // Gains at iteration 0, derived from c_end and r_end
+};
+
+vector<Parameter> loadParameters(const string& path) {
+    vector<Parameter> parameters;
+    ifstream in(path);
+    string line;
+    while (getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        istringstream fields(line);
+        Parameter p;
+        double cEnd, rEnd;
+        if (!(fields >> p.name >> p.value >> p.min >> p.max >> cEnd >> rEnd)) {
+            cerr << "Skipping malformed line: " << line << endl;
+            continue;
+        }
+        p.c = cEnd * pow(ITERATIONS, GAMMA);
+        p.a = rEnd * cEnd * cEnd * pow(0.1 * ITERATIONS + ITERATIONS, ALPHA);
+        parameters.push_back(p);
+    }
+    return parameters;
+}
+
+string formatValue(double value) {
+    ostringstream out;
+    out << setprecision(6) << value;
+    return out.str();
+}
+
+// config.txt format; integers are rounded by the engine, so they are rounded here too
+void writeValues(const string& path, const vector<Parameter>& parameters, int iteration) {
+    ofstream out(path);
+    out << "# SPSA after " << iteration << " of " << ITERATIONS << " iterations" << endl;
+    for (const auto& p : parameters) out << p.name << "=" << formatValue(p.value) << endl;
+}
+
+int main(int argc, char* argv[]) {
+    string engine, paramsPath = "spsa_params.txt", openingsPath, outputPath = "spsa_result.txt";
+    unsigned seed = random_device{}();
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "-e" && i + 1 < argc) engine = argv[++i];
+        else if (arg == "-p" && i + 1 < argc) paramsPath = argv[++i];
+        else if ((arg == "-i" || arg == "--iterations") && i + 1 < argc) ITERATIONS = max(1, stoi(argv[++i]));
+        else if ((arg == "-c" || arg == "--concurrency") && i + 1 < argc) CONCURRENCY = max(1, stoi(argv[++i]));
+        else if (arg == "--tc" && i + 1 < argc) parseTimeControl(argv[++i], TC);
+        else if (arg == "--margin" && i + 1 < argc) TC.marginMs = stol(argv[++i]);
+        else if (arg == "--openings" && i + 1 < argc) openingsPath = argv[++i];
+        else if (arg == "-o" && i + 1 < argc) outputPath = argv[++i];
+        else if (arg == "--seed" && i + 1 < argc) seed = static_cast<unsigned>(stoul(argv[++i]));
+        else {
+            cerr << "Unknown argument " << arg << endl;
+            return 1;
+        }
+    }
+    if (engine.empty()) {
+        cerr << "Usage: " << argv[0] << " -e engine [-p spsa_params.txt] [-i iterations] [-c concurrency]"
+             << " [--tc base+inc] [--margin ms] [--openings file] [-o spsa_result.txt] [--seed N]" << endl;
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);   // A crashed engine must not take the tuner with it
+
+    vector<Parameter> parameters = loadParameters(paramsPath);
+    vector<Opening> openings = loadOpenings(openingsPath);
+    if (parameters.empty() || openings.empty()) {
+        cerr << (parameters.empty() ? "No parameters in " + paramsPath : "No openings in " + openingsPath) << endl;
+        return 1;
+    }
+
+    mutex theta_mutex;
+    int next = 0, finished = 0;
+    long pluses = 0, minuses = 0;   // Game points won by theta+ and theta- overall
+    auto start = Clock::now();
+
+    cout << "SPSA " << engine << ": " << parameters.size() << " parameters, " << ITERATIONS << " game pairs, tc "
+         << TC.baseMs / 1000.0 << "+" << TC.incMs / 1000.0 << ", " << CONCURRENCY << " concurrent" << endl;
+
+    auto worker = [&](unsigned workerSeed) {
+        mt19937 rng(workerSeed);
+        EngineProcess plus(engine), minus(engine);
+        while (true) {
+            int k;
+            vector<double> delta(parameters.size()), step(parameters.size());
+            {
+                lock_guard<mutex> lock(theta_mutex);
+                if (next >= ITERATIONS) return;
+                k = next++;
+                for (size_t i = 0; i < parameters.size(); ++i) {
+                    const Parameter& p = parameters[i];
+                    delta[i] = rng() & 1 ? 1.0 : -1.0;
+                    step[i] = p.c / pow(k + 1, GAMMA);
+                    plus.setOption(p.name, formatValue(min(max(p.value + step[i] * delta[i], p.min), p.max)));
+                    minus.setOption(p.name, formatValue(min(max(p.value - step[i] * delta[i], p.min), p.max)));
+                }
+            }
+
+            // Both colors from the same opening, so the opening itself does not bias the result
+            const Opening& opening = openings[k % openings.size()];
+            int result = 0;     // Wins minus losses of theta+
+            for (int game = 0; game < 2; ++game) {
+                EngineProcess* engines[2] = {game == 0 ? &plus : &minus, game == 0 ? &minus : &plus};
+                GameRecord record = playGame(engines, opening, TC);
+                if (record.result == "1-0") result += game == 0 ? 1 : -1;
+                else if (record.result == "0-1") result += game == 0 ? -1 : 1;
+            }
+
+            lock_guard<mutex> lock(theta_mutex);
+            for (size_t i = 0; i < parameters.size(); ++i) {
+                Parameter& p = parameters[i];
+                double gain = p.a / pow(0.1 * ITERATIONS + k + 1, ALPHA) / step[i];
+                p.value = min(max(p.value + gain * result * delta[i], p.min), p.max);
+            }
+            if (result > 0) pluses += result;
+            else minuses -= result;
+            ++finished;
+            writeValues(outputPath, parameters, finished);
+
+            cout << fixed << setprecision(2) << "Iteration " << setw(5) << finished << "/" << ITERATIONS << " ("
+                 << showpos << result << noshowpos << ")";
+            for (const auto& p : parameters) cout << "  " << p.name << " " << p.value;
+            cout << endl;
+        }
+    };
+
+    vector<thread> workers;
+    for (int i = 0; i < CONCURRENCY; ++i) workers.emplace_back(worker, seed + i);
+    for (auto& t : workers) t.join();
+
+    long elapsed = chrono::duration_cast<chrono::seconds>(Clock::now() - start).count();
+    cout << "===========================" << endl;
+    cout << "Game pairs       : " << finished << " (theta+ " << pluses << ", theta- " << minuses << " decisive points)" << endl;
+    for (const auto& p : parameters)
+        cout << left << setw(17) << p.name << right << ": " << formatValue(p.value) << endl;
+    cout << "Time (s)         : " << elapsed << endl;
+    cout << "Values           : " << outputPath << " (config.txt format)" << endl;
+    return 0;
+}
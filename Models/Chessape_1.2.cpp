@@ -18,6 +18,7 @@
 #include <bitset>
 
 #include "../../chess-library/include/chess.hpp"
+#include "evaluation_tables.h"
 
 
 using namespace chess;
@@ -100,408 +101,6 @@ unsigned char black_pawns = 0;
 
 enum class GameStage { EARLY, MID, END };
 
-// In the Evaluation namespace, define separate piece–square tables for each stage.
-// For now we copy the current values for early game into mid and endgame; you can tune them later.
-namespace Evaluation {
-    constexpr short PST_early[2][6][64] = {
-        { // White tables
-            {   // Pawn table × 1
-                0,   0,   0,   0,   0,   0,   0,   0,
-                90,  95,  95,  95,  95, 100,  95,  90,
-                95,  95,  95, 110, 110,  90,  90,  95,
-                90,  90, 100, 130, 130,  90,  90,  90,
-               105, 105, 120, 140, 140, 120, 105, 105,
-               125, 130, 140, 150, 150, 140, 130, 125,
-               170, 180, 190, 210, 210, 190, 180, 170,
-                 0,   0,   0,   0,   0,   0,   0,   0
-           },
-           {   // Knight table × 3
-               240, 280, 280, 280, 280, 280, 260, 240,
-               270, 290, 310, 315, 315, 310, 290, 270,
-               280, 310, 315, 330, 330, 315, 310, 280,
-               280, 315, 330, 335, 335, 330, 315, 280,
-               280, 315, 330, 335, 335, 330, 315, 280,
-               280, 310, 315, 330, 330, 315, 310, 280,
-               270, 290, 310, 315, 315, 310, 290, 270,
-               240, 280, 280, 280, 280, 280, 280, 240
-           },
-           {   // Bishop table × 3
-               260, 280, 300, 290, 290, 300, 280, 260,
-               280, 335, 300, 315, 315, 300, 335, 280,
-               300, 305, 325, 310, 310, 325, 305, 300,
-               315, 315, 325, 325, 325, 325, 315, 315,
-               290, 325, 325, 325, 325, 325, 325, 290,
-               300, 300, 325, 325, 325, 325, 300, 300,
-               280, 335, 300, 315, 315, 300, 335, 280,
-               260, 280, 300, 290, 290, 300, 280, 260
-           },
-           {   // Rook table × 5
-               480, 480, 480, 505, 505, 480, 480, 480,
-               480, 480, 490, 510, 510, 490, 480, 480,
-               490, 490, 490, 515, 515, 490, 490, 490,
-               490, 490, 490, 490, 490, 490, 490, 490,
-               490, 490, 490, 490, 490, 490, 490, 490,
-               490, 490, 490, 490, 490, 490, 490, 490,
-               515, 515, 515, 530, 530, 515, 515, 515,
-               500, 500, 500, 510, 510, 500, 500, 500
-           },
-           {   // Queen table × 9
-               850, 870, 890, 905, 905, 890, 870, 850,
-               870, 890, 905, 905, 905, 905, 890, 870,
-               885, 905, 910, 910, 910, 910, 905, 885,
-               905, 910, 910, 910, 910, 910, 910, 900,
-               900, 910, 910, 910, 910, 910, 910, 905,
-               900, 900, 910, 910, 910, 910, 900, 900,
-               905, 905, 910, 910, 910, 910, 905, 905,
-               900, 905, 910, 910, 910, 910, 905, 900
-           },
-           {   // King table × 0
-               35,40,40,25,25,25,45,35,
-               15,15,15,15,15,15,15,15,
-                0, 0, 0, 0, 0, 0, 0, 0,
-                0, 0, 0, 0, 0, 0, 0, 0,
-                0, 0, 0, 0, 0, 0, 0, 0,
-                0, 0, 0, 0, 0, 0, 0, 0,
-                0, 0, 0, 0, 0, 0, 0, 0,
-                0, 0, 0, 0, 0, 0, 0, 0
-           }
-       },
-       { // Black tables
-           {   // Pawn table × 1
-                  0,   0,    0,    0,    0,     0,    0,    0,
-               -170, -180, -190, -210, -210, -190, -180, -170,
-               -125, -130, -140, -150, -150, -140, -130, -125,
-               -105, -105, -120, -140, -140, -120, -105, -105,
-                -90,  -90, -100, -130, -130,  -90,  -90,  -90,
-                -95,  -95,  -95, -110, -110,  -90,  -90,  -95,
-                -90,  -95,  -95,  -95,  -95, -100,  -95,  -90,
-                  0,    0,    0,    0,    0,    0,    0,    0
-           },
-           {   // Knight table × 3
-               -240, -280, -280, -280, -280, -280, -260, -240,
-               -270, -290, -310, -315, -315, -310, -290, -270,
-               -280, -310, -315, -330, -330, -315, -310, -280,
-               -280, -315, -330, -335, -335, -330, -315, -280,
-               -280, -315, -330, -335, -335, -330, -315, -280,
-               -280, -310, -315, -330, -330, -315, -310, -280,
-               -270, -290, -310, -315, -315, -310, -290, -270,
-               -240, -280, -280, -280, -280, -280, -280, -240
-           },
-           {   // Bishop table × 3
-               -260, -280, -300, -290, -290, -300, -280, -260,
-               -280, -335, -300, -315, -315, -300, -335, -280,
-               -300, -300, -325, -325, -325, -325, -300, -300,
-               -290, -325, -325, -325, -325, -325, -325, -290,
-               -315, -315, -325, -325, -325, -325, -315, -315,
-               -300, -305, -325, -310, -310, -325, -305, -300,
-               -280, -335, -300, -315, -315, -300, -335, -280,
-               -260, -280, -300, -290, -290, -300, -280, -260
-           },
-           {   // Rook table × 5
-               -500, -500, -500, -510, -510, -500, -500, -500,
-               -515, -515, -515, -530, -530, -515, -515, -515,
-               -490, -490, -490, -490, -490, -490, -490, -490,
-               -490, -490, -490, -490, -490, -490, -490, -490,
-               -490, -490, -490, -490, -490, -490, -490, -490,
-               -490, -490, -490, -515, -515, -490, -490, -490,
-               -480, -480, -490, -510, -510, -490, -480, -480,
-               -480, -480, -480, -505, -505, -480, -480, -480
-           },
-           {   // Queen table × 9
-               -900, -905, -910, -910, -910, -910, -905, -900,
-               -905, -905, -910, -910, -910, -910, -905, -905,
-               -900, -900, -910, -910, -910, -910, -900, -900,
-               -900, -910, -910, -910, -910, -910, -910, -905,
-               -905, -910, -910, -910, -910, -910, -910, -900,
-               -885, -905, -910, -910, -910, -910, -905, -885,
-               -870, -890, -905, -905, -905, -905, -890, -870,
-               -850, -870, -890, -905, -905, -890, -870, -850     
-           },
-           {   // King table × 0
-               0,  0,  0,  0,  0,  0,  0,  0,
-               0,  0,  0,  0,  0,  0,  0,  0,
-               0,  0,  0,  0,  0,  0,  0,  0,
-               0,  0,  0,  0,  0,  0,  0,  0,
-               0,  0,  0,  0,  0,  0,  0,  0,
-               0,  0,  0,  0,  0,  0,  0,  0,
-             -15,-15,-15,-15,-15,-15,-15,-15,
-             -35,-40,-40,-25,-25,-25,-45,-35
-           }
-       }
-    };
-    constexpr short PST_mid[2][6][64] = {
-        { // White tables
-            {   // Pawn table × 1
-                0,   0,   0,   0,   0,   0,   0,   0,
-                90,  95,  95,  95,  95, 100,  95,  90,
-                95,  95,  95, 110, 110,  90,  90,  95,
-                90,  90, 100, 130, 130,  90,  90,  90,
-               105, 105, 120, 140, 140, 120, 105, 105,
-               125, 130, 140, 150, 150, 140, 130, 125,
-               170, 180, 190, 210, 210, 190, 180, 170,
-                 0,   0,   0,   0,   0,   0,   0,   0
-           },
-           {   // Knight table × 3
-               240, 280, 280, 280, 280, 280, 260, 240,
-               270, 290, 310, 315, 315, 310, 290, 270,
-               280, 310, 315, 330, 330, 315, 310, 280,
-               280, 315, 330, 335, 335, 330, 315, 280,
-               280, 315, 330, 335, 335, 330, 315, 280,
-               280, 310, 315, 330, 330, 315, 310, 280,
-               270, 290, 310, 315, 315, 310, 290, 270,
-               240, 280, 280, 280, 280, 280, 280, 240
-           },
-           {   // Bishop table × 3
-               260, 280, 300, 290, 290, 300, 280, 260,
-               280, 335, 300, 315, 315, 300, 335, 280,
-               300, 305, 325, 310, 310, 325, 305, 300,
-               315, 315, 325, 325, 325, 325, 315, 315,
-               290, 325, 325, 325, 325, 325, 325, 290,
-               300, 300, 325, 325, 325, 325, 300, 300,
-               280, 335, 300, 315, 315, 300, 335, 280,
-               260, 280, 300, 290, 290, 300, 280, 260
-           },
-           {   // Rook table × 5
-               480, 480, 480, 505, 505, 480, 480, 480,
-               480, 480, 490, 510, 510, 490, 480, 480,
-               490, 490, 490, 515, 515, 490, 490, 490,
-               490, 490, 490, 490, 490, 490, 490, 490,
-               490, 490, 490, 490, 490, 490, 490, 490,
-               490, 490, 490, 490, 490, 490, 490, 490,
-               515, 515, 515, 530, 530, 515, 515, 515,
-               500, 500, 500, 510, 510, 500, 500, 500
-            },
-           {   // Queen table × 9
-               850, 870, 890, 900, 900, 890, 870, 850,
-               870, 890, 900, 905, 905, 900, 890, 870,
-               885, 905, 915, 915, 915, 915, 905, 885,
-               905, 910, 910, 910, 910, 910, 910, 900,
-               900, 910, 910, 910, 910, 910, 910, 905,
-               900, 900, 910, 910, 910, 910, 900, 900,
-               905, 905, 910, 910, 910, 910, 905, 905,
-               900, 905, 910, 910, 910, 910, 905, 900
-           },
-           {   // King table × 0
-               35,40,40,25,25,25,45,35,
-               15,15,15,15,15,15,15,15,
-               0, 0, 0, 0, 0, 0, 0, 0,
-               0, 0, 0, 0, 0, 0, 0, 0,
-               0, 0, 0, 0, 0, 0, 0, 0,
-               0, 0, 0, 0, 0, 0, 0, 0,
-               0, 0, 0, 0, 0, 0, 0, 0,
-               0, 0, 0, 0, 0, 0, 0, 0
-           }
-       },
-       { // Black tables
-           {   // Pawn table × 1
-                  0,   0,    0,    0,    0,     0,    0,    0,
-               -170, -180, -190, -210, -210, -190, -180, -170,
-               -125, -130, -140, -150, -150, -140, -130, -125,
-               -105, -105, -120, -140, -140, -120, -105, -105,
-                -90,  -90, -100, -130, -130,  -90,  -90,  -90,
-                -95,  -95,  -95, -110, -110,  -90,  -90,  -95,
-                -90,  -95,  -95,  -95,  -95, -100,  -95,  -90,
-                  0,    0,    0,    0,    0,    0,    0,    0
-           },
-           {   // Knight table × 3
-               -240, -280, -280, -280, -280, -280, -260, -240,
-               -270, -290, -310, -315, -315, -310, -290, -270,
-               -280, -310, -315, -330, -330, -315, -310, -280,
-               -280, -315, -330, -335, -335, -330, -315, -280,
-               -280, -315, -330, -335, -335, -330, -315, -280,
-               -280, -310, -315, -330, -330, -315, -310, -280,
-               -270, -290, -310, -315, -315, -310, -290, -270,
-               -240, -280, -280, -280, -280, -280, -280, -240
-           },
-           {   // Bishop table × 3
-               -260, -280, -300, -290, -290, -300, -280, -260,
-               -280, -335, -300, -315, -315, -300, -335, -280,
-               -300, -300, -325, -325, -325, -325, -300, -300,
-               -290, -325, -325, -325, -325, -325, -325, -290,
-               -315, -315, -325, -325, -325, -325, -315, -315,
-               -300, -305, -325, -310, -310, -325, -305, -300,
-               -280, -335, -300, -315, -315, -300, -335, -280,
-               -260, -280, -300, -290, -290, -300, -280, -260
-           },
-           {   // Rook table × 5
-               -500, -500, -500, -510, -510, -500, -500, -500,
-               -515, -515, -515, -530, -530, -515, -515, -515,
-               -490, -490, -490, -490, -490, -490, -490, -490,
-               -490, -490, -490, -490, -490, -490, -490, -490,
-               -490, -490, -490, -490, -490, -490, -490, -490,
-               -490, -490, -490, -515, -515, -490, -490, -490,
-               -480, -480, -490, -510, -510, -490, -480, -480,
-               -480, -480, -480, -505, -505, -480, -480, -480
-           },
-           {   // Queen table × 9
-               -900, -905, -910, -910, -910, -910, -905, -900,
-               -905, -905, -910, -910, -910, -910, -905, -905,
-               -900, -900, -910, -910, -910, -910, -900, -900,
-               -900, -910, -910, -910, -910, -910, -910, -905,
-               -905, -910, -910, -910, -910, -910, -910, -900,
-               -885, -905, -915, -915, -915, -915, -905, -885,
-               -870, -890, -900, -905, -905, -900, -890, -870,
-               -850, -870, -890, -900, -900, -890, -870, -850     
-           },
-           {   // King table × 0
-               0,  0,  0,  0,  0,  0,  0,  0,
-               0,  0,  0,  0,  0,  0,  0,  0,
-               0,  0,  0,  0,  0,  0,  0,  0,
-               0,  0,  0,  0,  0,  0,  0,  0,
-               0,  0,  0,  0,  0,  0,  0,  0,
-               0,  0,  0,  0,  0,  0,  0,  0,
-             -15,-15,-15,-15,-15,-15,-15,-15,
-             -35,-40,-40,-25,-25,-25,-45,-35
-           }
-       }
-    };
-    constexpr short PST_end[2][6][64] = {
-        { // White tables
-            {   // Pawn table × 1
-                0,   0,   0,   0,   0,   0,   0,   0,
-                90,  95,  95,  95,  95,  95,  95,  90,
-                95,  95,  95, 110, 110,  95,  95,  95,
-               100, 100, 100, 130, 130, 100, 100, 100,
-               105, 105, 120, 140, 140, 120, 105, 105,
-               135, 140, 150, 160, 160, 150, 140, 135,
-               180, 190, 200, 220, 220, 200, 190, 180,
-                 0,   0,   0,   0,   0,   0,   0,   0
-           },
-           {   // Knight table × 3
-               260, 290, 290, 290, 290, 290, 290, 260,
-               290, 300, 305, 305, 305, 305, 300, 290,
-               290, 305, 305, 310, 310, 305, 305, 290,
-               290, 305, 310, 315, 315, 310, 305, 290,
-               290, 305, 310, 315, 315, 310, 305, 290,
-               290, 305, 305, 310, 310, 305, 305, 290,
-               290, 300, 305, 305, 305, 305, 300, 290,
-               260, 290, 290, 290, 290, 290, 290, 260
-           },
-           {   // Bishop table × 3
-               270, 280, 300, 300, 300, 300, 280, 270,
-               280, 325, 315, 315, 315, 315, 325, 280,
-               300, 315, 325, 325, 325, 325, 315, 300,
-               300, 325, 325, 325, 325, 325, 325, 300,
-               300, 325, 325, 325, 325, 325, 325, 300,
-               300, 315, 325, 325, 325, 325, 315, 300,
-               300, 325, 315, 315, 315, 315, 325, 280,
-               270, 280, 300, 300, 300, 300, 280, 270
-           },
-           {   // Rook table × 5
-               510, 510, 510, 510, 510, 510, 510, 510,
-               510, 510, 510, 510, 510, 510, 510, 510,
-               510, 510, 510, 510, 510, 510, 510, 510,
-               510, 510, 510, 510, 510, 510, 510, 510,
-               510, 510, 510, 510, 510, 510, 510, 510,
-               510, 510, 510, 510, 510, 510, 510, 510,
-               520, 520, 520, 520, 520, 520, 520, 520,
-               510, 510, 510, 510, 510, 510, 510, 510,
-           },
-           {   // Queen table × 9
-               900, 900, 905, 910, 910, 905, 900, 900,
-               900, 900, 910, 910, 910, 910, 900, 900,
-               900, 900, 910, 910, 910, 910, 900, 900,
-               900, 910, 910, 910, 910, 910, 910, 900,
-               900, 910, 910, 910, 910, 910, 910, 900,
-               900, 900, 910, 910, 910, 910, 900, 900,
-               900, 900, 910, 910, 910, 910, 900, 900,
-               900, 900, 905, 910, 910, 905, 900, 900
-           },
-           {   // King table × 0
-               0, 0, 0, 0, 0, 0, 0, 0,
-               0, 0, 0, 0, 0, 0, 0, 0,
-               0, 0, 5, 5, 5, 5, 0, 0,
-               0, 0, 5, 5, 5, 5, 0, 0,
-               0, 0, 5, 5, 5, 5, 0, 0,
-               0, 0, 5, 5, 5, 5, 0, 0,
-               0, 0, 0, 0, 0, 0, 0, 0,
-               0, 0, 0, 0, 0, 0, 0, 0
-           }
-       },
-       { // Black tables
-           {   // Pawn table × 1
-                  0,   0,    0,    0,    0,     0,    0,    0,
-               -180, -190, -200, -220, -220, -200, -190, -180,
-               -135, -140, -150, -160, -160, -150, -140, -135,
-               -105, -105, -120, -140, -140, -120, -105, -105,
-               -100, -100, -100, -130, -130, -100, -100, -100,
-                -95,  -95,  -95, -110, -110,  -95,  -95,  -95,
-                -90,  -95,  -95,  -95,  -95,  -95,  -95,  -90,
-                  0,    0,    0,    0,    0,    0,    0,    0
-           },
-           {   // Knight table × 3
-               -260, -290, -290, -290, -290, -290, -290, -260,
-               -290, -300, -305, -305, -305, -305, -300, -290,
-               -290, -305, -305, -310, -310, -305, -305, -290,
-               -290, -305, -310, -315, -315, -310, -305, -290,
-               -290, -305, -310, -315, -315, -310, -305, -290,
-               -290, -305, -305, -310, -310, -305, -305, -290,
-               -290, -300, -305, -305, -305, -305, -300, -290,
-               -260, -290, -290, -290, -290, -290, -290, -260
-           },
-           {   // Bishop table × 3
-               -270, -280, -300, -300, -300, -300, -280, -270,
-               -280, -325, -315, -315, -315, -315, -325, -280,
-               -300, -315, -325, -325, -325, -325, -315, -300,
-               -300, -325, -325, -325, -325, -325, -325, -300,
-               -300, -325, -325, -325, -325, -325, -325, -300,
-               -300, -315, -325, -325, -325, -325, -315, -300,
-               -280, -325, -315, -315, -315, -315, -325, -280,
-               -270, -280, -300, -300, -300, -300, -280, -270
-           },
-           {   // Rook table × 5
-               -510, -510, -510, -510, -510, -510, -510, -510,
-               -520, -520, -520, -520, -520, -520, -520, -520,
-               -510, -510, -510, -510, -510, -510, -510, -510,
-               -510, -510, -510, -510, -510, -510, -510, -510,
-               -510, -510, -510, -510, -510, -510, -510, -510,
-               -510, -510, -510, -510, -510, -510, -510, -510,
-               -510, -510, -510, -510, -510, -510, -510, -510,
-               -510, -510, -510, -510, -510, -510, -510, -510,
-           },
-           {   // Queen table × 9
-               -900, -900, -905, -910, -910, -905, -900, -900,
-               -900, -900, -910, -910, -910, -910, -900, -900,
-               -900, -900, -910, -910, -910, -910, -900, -900,
-               -900, -910, -910, -910, -910, -910, -910, -900,
-               -900, -910, -910, -910, -910, -910, -910, -900,
-               -900, -900, -910, -910, -910, -910, -900, -900,
-               -900, -900, -910, -910, -910, -910, -900, -900,
-               -900, -900, -905, -910, -910, -905, -900, -900     
-           },
-           {   // King table × 0
-               0, 0, 0, 0, 0, 0, 0, 0,
-               0, 0, 0, 0, 0, 0, 0, 0,
-               0, 0, -5, -5, -5, -5, 0, 0,
-               0, 0, -5, -5, -5, -5, 0, 0,
-               0, 0, -5, -5, -5, -5, 0, 0,
-               0, 0, -5, -5, -5, -5, 0, 0,
-               0, 0, 0, 0, 0, 0, 0, 0,
-               0, 0, 0, 0, 0, 0, 0, 0
-           }
-       }
-    };
-
-    vector<short>Pawn_structure = {
-        0, -15, -15,   0, -15, -45,   0,   0, -15, -45, -45, -30,   0, -30,   0,   0,
-      -15, -45, -45, -30, -45, -75, -30, -30,   0, -30, -30, -15,   0, -30,   0,   0,
-      -15, -45, -45, -30, -45, -75, -30, -30, -45, -75, -75, -60, -30, -60, -30, -30, 
-        0, -30, -30, -15, -30, -60, -15, -15,   0, -30, -30, -15,   0, -30,   0,   0, 
-      -15, -45, -45, -30, -45, -75, -30, -30, -45, -75, -75, -60, -30, -60, -30, -30, 
-      -45, -75, -75, -60, -75,-105, -60, -60, -30, -60, -60, -45, -30, -60, -30, -30, 
-        0, -30, -30, -15, -30, -60, -15, -15, -30, -60, -60, -45, -15, -45, -15, -15, 
-        0, -30, -30, -15, -30, -60, -15, -15,   0, -30, -30, -15,   0, -30,   0,   0, 
-      -15, -45, -45, -30, -45, -75, -30, -30, -45, -75, -75, -60, -30, -60, -30, -30, 
-      -45, -75, -75, -60, -75,-105, -60, -60, -30, -60, -60, -45, -30, -60, -30, -30, 
-      -45, -75, -75, -60, -75,-105, -60, -60, -75,-105,-105, -90, -60, -90, -60, -60, 
-      -30, -60, -60, -45, -60, -90, -45, -45, -30, -60, -60, -45, -30, -60, -30, -30, 
-        0, -30, -30, -15, -30, -60, -15, -15, -30, -60, -60, -45, -15, -45, -15, -15, 
-      -30, -60, -60, -45, -60, -90, -45, -45, -15, -45, -45, -30, -15, -45, -15, -15, 
-        0, -30, -30, -15, -30, -60, -15, -15, -30, -60, -60, -45, -15, -45, -15, -15, 
-        0, -30, -30, -15, -30, -60, -15, -15,   0, -30, -30, -15,   0, -30,   0,  0
-  };
-}
-
 // Global variable to hold the current game stage for the whole search.
 GameStage currentStage = GameStage::EARLY;
 
@@ -16,9 +16,36 @@
 #include <sqlite3.h>
 #include <random>
 #include <bitset>
+#include <filesystem>
+#include <algorithm>
+#include <memory>
+#include <array>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <future>
+#include <optional>
+
+#include <csignal>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
 
 #include "../../chess-library/include/chess.hpp"
 #include "nnue_eval.h"
+#include "opening_book.h"
+#include "syzygy.h"
+#include "bitbase.h"
+#include "perft.h"
+#include "profiler.h"
+#include "perf_counters.h"
+#include "hash_memory.h"
+#include "alloc_tracker.h"
+#include "log.h"
+#include "../NNUE/packed_position.h"
 
 NNUE nnue_model("weights.txt");
 
@@ -29,14 +56,16 @@ using Clock = std::chrono::steady_clock;
 // Debug macro: prints only when compiled with -DDEBUG
 #ifdef DEBUG
     #define DEBUG_PRINT(x) (std::cerr << x << std::endl)
-    // Global counter for nodes analyzed during search (each recursive call is counted)
-    uint64_t nodesAnalyzed = 0;
 #else
     #define DEBUG_PRINT(x) ((void)0)
 #endif
 
+// Nodes analyzed by this thread's search (each recursive call is counted)
+thread_local uint64_t nodesAnalyzed = 0;
+
 // Configuration values
-constexpr int HASH_TABLE_SIZE = 2097152;  // 2^21
+size_t HASH_MB = 2;                     // Position table size, the UCI Hash option (2 MB: 2^21 entries)
+constexpr size_t MAX_HASH_MB = 65536;
 double R_FACTOR = 0.5;
 double RANDOM_COEFF = 0.5;
 int EARLY_GAME_MOVES = 50;
@@ -47,6 +76,60 @@ int INCR_MIN_DEPTH = 1;
 int INCR_MAX_DEPTH = 2;
 int FIRST_MIN_DEPTH = 5;
 int FIRST_MAX_DEPTH = 14;
+int NULL_MOVE_MARGIN = 100;     // Static eval must beat beta by this much to try a null move
+int NULL_MOVE_REDUCTION = 2;    // Depth taken off the null move search
+int STAND_PAT_MARGIN = 10;      // Taken off the static eval when standing pat in quiescence
+
+// Tunable parameters: read from config.txt and settable, under the same names, as UCI options,
+// so the SPSA tuner (Estimate_ELO/spsa_tuner.cpp) can change them between games without a
+// rebuild. Integers are spin options; real values are string options since UCI has no floats.
+struct Tunable {
+    const char* name;
+    int* integer;       // Exactly one of integer and real is set
+    double* real;
+    double min, max;
+};
+
+const Tunable TUNABLES[] = {
+    {"r_factor", nullptr, &R_FACTOR, 0, 1},
+    {"random_coeff", nullptr, &RANDOM_COEFF, 0, 1},
+    {"early_game_moves", &EARLY_GAME_MOVES, nullptr, 5, 100},
+    {"mid_game_moves", &MID_GAME_MOVES, nullptr, 5, 100},
+    {"end_game_moves", &END_GAME_MOVES, nullptr, 5, 100},
+    {"movetime_minimum", nullptr, &MOVETIME_MINIMUM, 0, 1},
+    {"incr_min_depth", &INCR_MIN_DEPTH, nullptr, 0, 4},
+    {"incr_max_depth", &INCR_MAX_DEPTH, nullptr, 0, 8},
+    {"first_min_depth", &FIRST_MIN_DEPTH, nullptr, 1, 12},
+    {"first_max_depth", &FIRST_MAX_DEPTH, nullptr, 1, 40},
+    {"null_move_margin", &NULL_MOVE_MARGIN, nullptr, 0, 1000},
+    {"null_move_reduction", &NULL_MOVE_REDUCTION, nullptr, 1, 6},
+    {"stand_pat_margin", &STAND_PAT_MARGIN, nullptr, -100, 100},
+};
+
+// Set a tunable from text, clamped to its range; integers are rounded so the tuner may send
+// real values. False if there is no such tunable or the value is not a number.
+bool setTunable(const string& name, const string& value) {
+    for (const Tunable& tunable : TUNABLES) {
+        if (name != tunable.name) continue;
+        char* end;
+        double number = strtod(value.c_str(), &end);
+        if (end == value.c_str()) return false;
+        number = min(max(number, tunable.min), tunable.max);
+        if (tunable.integer) *tunable.integer = static_cast<int>(lround(number));
+        else *tunable.real = number;
+        return true;
+    }
+    return false;
+}
+
+// A spin option's value, clamped to its range like the tunables. False if it is not a number
+bool parseSpin(const string& value, long min, long max, long& number) {
+    char* end;
+    double parsed = strtod(value.c_str(), &end);
+    if (end == value.c_str() || parsed != parsed) return false;
+    number = lround(std::min(std::max(parsed, static_cast<double>(min)), static_cast<double>(max)));
+    return true;
+}
 
 short evaluateBoardNNUE(const chess::Board& board);  // forward declaration
 
@@ -75,17 +158,11 @@ void loadConfig() {
             value.erase(0, value.find_first_not_of(" \t"));
             value.erase(value.find_last_not_of(" \t") + 1);
             
-            // Set values
-            if (key == "r_factor") R_FACTOR = stod(value);
-            else if (key == "random_coeff") RANDOM_COEFF = stod(value);
-            else if (key == "early_game_moves") EARLY_GAME_MOVES = stoi(value);
-            else if (key == "mid_game_moves") MID_GAME_MOVES = stoi(value);
-            else if (key == "end_game_moves") END_GAME_MOVES = stoi(value);
-            else if (key == "movetime_minimum") MOVETIME_MINIMUM = stod(value);
-            else if (key == "incr_min_depth") INCR_MIN_DEPTH = stoi(value);
-            else if (key == "incr_max_depth") INCR_MAX_DEPTH = stoi(value);
-            else if (key == "first_min_depth") FIRST_MIN_DEPTH = stoi(value);
-            else if (key == "first_max_depth") FIRST_MAX_DEPTH = stoi(value);
+            // Set values. hash_table_size counts one-byte entries, as when the table was fixed
+            if (key == "hash_table_size")
+                HASH_MB = clamp<size_t>(strtoull(value.c_str(), nullptr, 10) >> 20, 1, MAX_HASH_MB);
+            else
+                setTunable(key, value);
         }
     }
     
@@ -93,38 +170,326 @@ void loadConfig() {
 }
 
 constexpr short INFINITY_VAL = numeric_limits<short>::max();
+constexpr short TB_WIN_SCORE = 30000;   // Tablebase wins, below mate scores
+
+// Bitbases only know win/draw/loss, so a won position is scored TB_WIN_SCORE - 200 plus a
+// bonus that rewards progress: material (promoting beats pushing), the losing king near the
+// edge and the kings close together. Without it every winning move looks the same.
+short bitbaseWinScore(const Board &board, Color winner) {
+    static const short material[] = {0, 30, 30, 50, 60, 0}; // P, N, B, R, Q, K
+    short bonus = 0;
+    Bitboard pieces = board.us(winner);
+    while (pieces) {
+        int sq = pieces.pop();
+        int type = static_cast<int>(board.at(Square(sq)).type());
+        if (type == 0) bonus += 10 + 3 * (winner == Color::WHITE ? sq / 8 : 7 - sq / 8);
+        else bonus += material[type];
+    }
+    int loser = board.kingSq(~winner).index(), king = board.kingSq(winner).index();
+    int edge = max(3 - min(loser % 8, 7 - loser % 8), 3 - min(loser / 8, 7 - loser / 8));
+    int distance = max(abs(loser % 8 - king % 8), abs(loser / 8 - king / 8));
+    return TB_WIN_SCORE - 200 + bonus + 10 * edge + 4 * (7 - distance);
+}
 
 short EXPECTED_MOVES_LEFT = EARLY_GAME_MOVES;
 
+// Search state below is thread_local so that several searches (bench) can run at once
+
 // Pawn structure tracking
-vector<short> white_pawn_counts = vector<short>(8, 0);
-vector<short> black_pawn_counts = vector<short>(8, 0);
-unsigned char white_pawns = 0;
-unsigned char black_pawns = 0;
+thread_local array<short, 8> white_pawn_counts = {};
+thread_local array<short, 8> black_pawn_counts = {};
+thread_local unsigned char white_pawns = 0;
+thread_local unsigned char black_pawns = 0;
 
 enum class GameStage { EARLY, MID, END };
 
 // Global variable to hold the current game stage for the whole search.
-GameStage currentStage = GameStage::EARLY;
+thread_local GameStage currentStage = GameStage::EARLY;
 
 // Global incremental counters for extra bonuses.
-int white_bishop_count = 0, black_bishop_count = 0;
-std::vector<int> white_rooks_on_file(8, 0); // Number of white rooks on each file (0-7)
-std::vector<int> black_rooks_on_file(8, 0); // Same for black
+thread_local int white_bishop_count = 0, black_bishop_count = 0;
+thread_local std::array<int, 8> white_rooks_on_file = {}; // Number of white rooks on each file (0-7)
+thread_local std::array<int, 8> black_rooks_on_file = {}; // Same for black
+
+//-------------------------------------------------------------
+// Search statistics: plain per-thread counters, cheap enough for release builds. Each search
+// thread publishes its block when it finishes; `stats` shows the last search and the session.
+//-------------------------------------------------------------
+struct SearchStats {
+    uint64_t nodes = 0;
+    uint64_t qnodes = 0;              // Nodes past min_depth (captures/checks only)
+    uint64_t expandedNodes = 0;       // Nodes that searched at least one move
+    uint64_t movesSearched = 0;
+    uint64_t betaCutoffs = 0;
+    uint64_t firstMoveCutoffs = 0;    // Cutoffs produced by the first move tried
+    uint64_t standPatCutoffs = 0;
+    uint64_t nullMoveTries = 0;
+    uint64_t nullMoveCutoffs = 0;
+    uint64_t repetitionProbes = 0;    // There is no transposition table: the position table is
+    uint64_t repetitionHits = 0;      // the only hashed lookup, hits are positions seen before
+    uint64_t tablebaseHits = 0;       // Syzygy and bitbases
+    uint64_t evalCalls = 0;
+
+    SearchStats& operator+=(const SearchStats& o) {
+        nodes += o.nodes; qnodes += o.qnodes; expandedNodes += o.expandedNodes;
+        movesSearched += o.movesSearched; betaCutoffs += o.betaCutoffs;
+        firstMoveCutoffs += o.firstMoveCutoffs; standPatCutoffs += o.standPatCutoffs;
+        nullMoveTries += o.nullMoveTries; nullMoveCutoffs += o.nullMoveCutoffs;
+        repetitionProbes += o.repetitionProbes; repetitionHits += o.repetitionHits;
+        tablebaseHits += o.tablebaseHits; evalCalls += o.evalCalls;
+        return *this;
+    }
+
+    static double ratio(uint64_t a, uint64_t b) { return b ? double(a) / b : 0.0; }
+
+    string toJson() const {
+        ostringstream out;
+        out << fixed << setprecision(4)
+            << "{\"nodes\": " << nodes << ", \"qnodes\": " << qnodes
+            << ", \"expanded_nodes\": " << expandedNodes << ", \"moves_searched\": " << movesSearched
+            << ", \"beta_cutoffs\": " << betaCutoffs << ", \"first_move_cutoffs\": " << firstMoveCutoffs
+            << ", \"stand_pat_cutoffs\": " << standPatCutoffs
+            << ", \"null_move_tries\": " << nullMoveTries << ", \"null_move_cutoffs\": " << nullMoveCutoffs
+            << ", \"repetition_probes\": " << repetitionProbes << ", \"repetition_hits\": " << repetitionHits
+            << ", \"tablebase_hits\": " << tablebaseHits << ", \"eval_calls\": " << evalCalls
+            << ", \"first_move_cutoff_rate\": " << ratio(firstMoveCutoffs, betaCutoffs)
+            << ", \"null_move_success_rate\": " << ratio(nullMoveCutoffs, nullMoveTries)
+            << ", \"repetition_hit_rate\": " << ratio(repetitionHits, repetitionProbes)
+            << ", \"branching_factor\": " << ratio(movesSearched, expandedNodes) << "}";
+        return out.str();
+    }
+
+    string describe() const {
+        ostringstream out;
+        out << fixed << setprecision(1)
+            << "  nodes             : " << nodes << " (" << 100 * ratio(qnodes, nodes) << "% past min depth)\n"
+            << "  beta cutoffs      : " << betaCutoffs << " (" << 100 * ratio(firstMoveCutoffs, betaCutoffs)
+            << "% on the first move), " << standPatCutoffs << " stand pat\n"
+            << "  null move         : " << nullMoveCutoffs << "/" << nullMoveTries << " ("
+            << 100 * ratio(nullMoveCutoffs, nullMoveTries) << "% cut)\n"
+            << "  repetition table  : " << repetitionHits << "/" << repetitionProbes << " hits (no transposition table)\n"
+            << "  tablebase hits    : " << tablebaseHits << "\n"
+            << "  eval calls        : " << evalCalls << " (" << setprecision(2) << ratio(evalCalls, nodes) << " per node)\n"
+            << "  branching factor  : " << ratio(movesSearched, expandedNodes);
+        return out.str();
+    }
+};
+
+thread_local SearchStats searchStats;
+mutex stats_mutex;
+SearchStats lastSearchStats, sessionStats;
+
+// Start a new `go` or `bench` (before its threads run)
+void resetStats() {
+    lock_guard<mutex> lock(stats_mutex);
+    lastSearchStats = SearchStats();
+}
+
+// Add this thread's counters (and node count) to the totals and clear them
+void publishStats() {
+    searchStats.nodes = nodesAnalyzed;
+    lock_guard<mutex> lock(stats_mutex);
+    lastSearchStats += searchStats;
+    sessionStats += searchStats;
+    searchStats = SearchStats();
+}
 
 // Updated evaluateBoard: scan the board once and set the incremental counters.
 short evaluateBoard(Board &board) {
-    std::cerr << "[DEBUG] Calling evaluateBoardNNUE..." << std::endl;
+    PROFILE_SCOPE(EVAL);
+    ALLOC_PHASE(EVAL);
+    ++searchStats.evalCalls;
     short eval = evaluateBoardNNUE(board);
-    std::cerr << "[DEBUG] Got evaluation: " << eval << std::endl;
+    LOG_TRACE("evaluateBoard " << board.getFen() << ": " << eval);
     return eval;
 }
 
-short black(Board &board, short depth, short alpha, short beta, Move &bestMove, short currentEval, vector<uint8_t> &positionCounts, short min_depth,  short max_depth);
-short white(Board &board, short depth, short alpha, short beta, Move &bestMove, short currentEval, vector<uint8_t> &positionCounts, short min_depth,  short max_depth) {
-    #ifdef DEBUG
-    ++nodesAnalyzed; // Debug: count node analyzed for white search
-    #endif
+//-------------------------------------------------------------
+// Search reporting: principal variation, selective depth and UCI output
+//-------------------------------------------------------------
+constexpr int MAX_PLY = 128;
+constexpr long CURRMOVE_INTERVAL_MS = 1000;   // Progress lines are sent at most this often
+constexpr uint64_t LIMIT_CHECK_INTERVAL = 64; // Nodes between two checks of the search limits (a power of two)
+
+// Per-thread state the search updates as it goes
+struct SearchInfo {
+    int selDepth = 0;
+    int rootDepth = 0;
+    bool report = false;    // Send currmove progress lines (go, not bench)
+    Clock::time_point start, lastReport;
+    Move currMove;          // Root move being searched
+    int currMoveNumber = 0;
+    // Limits (0 or false for none). Once one is hit every node returns at once and the
+    // result of the root search is void.
+    uint64_t nodeLimit = 0;
+    bool timeLimit = false;
+    Clock::time_point deadline;
+    bool aborted = false;
+};
+thread_local SearchInfo searchInfo;
+
+inline bool limitReached() {
+    if ((searchInfo.nodeLimit && nodesAnalyzed >= searchInfo.nodeLimit) ||
+        (searchInfo.timeLimit && Clock::now() >= searchInfo.deadline))
+        searchInfo.aborted = true;
+    return searchInfo.aborted;
+}
+
+// Search stack: one cache-aligned entry per ply, preallocated per thread, holding what used to
+// live in the frames of the recursive white()/black() calls. A node gets its entry as `ss` and
+// passes ss + 1 to its children.
+struct alignas(64) SearchStack {
+    int ply = 0;                    // Distance from the root, null moves included (depth restarts on them)
+    short staticEval = 0;           // currentEval on entry
+    Move currentMove;               // Move being searched from this node
+    Move childBest;                 // Receives the children's best moves, which are not used
+    // Pawn structure saved before currentMove and restored after it
+    unsigned char whitePawns = 0, blackPawns = 0;
+    array<short, 8> whitePawnCounts = {}, blackPawnCounts = {};
+    Movelist legal;                 // Legal moves as generated
+    Movelist nullReplies;           // Legal replies to a null move
+    Movelist ordered;               // Moves in search order
+    int pvLength = 0;               // Best line found from this node
+    Move pv[MAX_PLY];
+};
+thread_local SearchStack searchStack[MAX_PLY];
+
+// Move ordering buckets. A node is done with them before it searches any child, so one set
+// per thread serves every ply.
+struct MoveBuckets {
+    Movelist queenPromotion, checkAndCapture, check, goodCapture, badCapture, quiet;
+
+    void clear() {
+        queenPromotion.clear(); checkAndCapture.clear(); check.clear();
+        goodCapture.clear(); badCapture.clear(); quiet.clear();
+    }
+};
+thread_local MoveBuckets moveBuckets;
+
+inline void updatePV(SearchStack *ss, const Move &move) {
+    ss->pv[0] = move;
+    for (int i = 0; i < (ss + 1)->pvLength; ++i) ss->pv[i + 1] = (ss + 1)->pv[i];
+    ss->pvLength = (ss + 1)->pvLength + 1;
+}
+
+string principalVariation() {
+    string pv;
+    for (int i = 0; i < searchStack[0].pvLength; ++i) pv += (i ? " " : "") + uci::moveToUci(searchStack[0].pv[i]);
+    return pv;
+}
+
+// UCI score from the side to move's point of view. Mates carry no distance in the search,
+// so it is taken from the length of the PV, which ends in the mate.
+string uciScore(short score, Color sideToMove) {
+    int s = sideToMove == Color::WHITE ? score : -score;
+    int pvLength = searchStack[0].pvLength;
+    if (abs(score) == INFINITY_VAL) return "mate " + to_string(s > 0 ? (pvLength + 1) / 2 : -(pvLength / 2));
+    return "cp " + to_string(s);
+}
+
+// Repetition counts of the positions on the search line and in the game, indexed by the low
+// bits of the Zobrist key: one byte per entry, a power of two of them in the given MB. Several
+// GB are possible, so the memory is huge page backed and cleared by several threads.
+class PositionTable {
+public:
+    explicit PositionTable(size_t mb) { resize(mb); }
+
+    // Drop every count and take the new size, halved until the memory can be had
+    void resize(size_t mb) {
+        size_t entries = 1;
+        while (entries * 2 <= (mb << 20)) entries *= 2;
+        while (!memory.resize(entries) && entries > 1) entries /= 2;
+        counts = static_cast<uint8_t*>(memory.data());
+        mask = entries - 1;
+    }
+
+    void clear(int threads = 1) { memory.clear(threads); }
+
+    size_t index(uint64_t zobrist) const { return zobrist & mask; }
+    uint8_t& operator[](size_t i) { return counts[i]; }
+    uint8_t operator[](size_t i) const { return counts[i]; }
+    size_t size() const { return mask + 1; }
+    bool hugePages() const { return memory.hugePages(); }
+
+private:
+    HashMemory memory;
+    uint8_t* counts = nullptr;
+    size_t mask = 0;
+};
+
+
+// Written to by SIGTERM and SIGINT while a server runs (serve), to wake it from poll
+int serveStopPipe[2] = {-1, -1};
+void requestServeStop(int) {
+    char byte = 0;
+    ssize_t written = write(serveStopPipe[1], &byte, 1);
+    (void)written;
+}
+
+// A server session's connection (serve). Its lines are written under its own mutex, so a
+// client slow to read holds up only its own session.
+struct OutputChannel {
+    int socket = -1;
+    mutex lock;
+    string pending;     // Unflushed lines, sent with the next flushed one
+};
+// Set on the threads working for a session: its connection thread and, during its searches,
+// the pool worker. Other threads write to stdout.
+thread_local OutputChannel* outputChannel = nullptr;
+
+// Every line goes out under one mutex so the UCI and search threads never interleave. Lines
+// are flushed by default, since a GUI waits on each one. The search's progress lines pass
+// flush = false and go out with the next flushed line (the iteration's info line or bestmove),
+// so the search never waits on a flush or on a client slow to read.
+mutex output_mutex;
+void uciOutput(const string &line, bool flush = true) {
+    if (outputChannel) {
+        lock_guard<mutex> lock(outputChannel->lock);
+        string& text = outputChannel->pending;
+        text += line;
+        text += '\n';
+        if (!flush) return;
+        for (size_t sent = 0; sent < text.size();) {
+            ssize_t n = send(outputChannel->socket, text.data() + sent, text.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0) break;  // The client is gone: the session ends when its reads fail
+            sent += n;
+        }
+        text.clear();
+        return;
+    }
+    lock_guard<mutex> lock(output_mutex);
+    cout << line << '\n';
+    if (flush) cout.flush();
+}
+
+// Polled every 1024 nodes; only talks when CURRMOVE_INTERVAL_MS passed since the last line
+void reportProgress() {
+    if (!searchInfo.report || searchInfo.currMoveNumber == 0) return;
+    ALLOC_PHASE(REPORT);
+    auto now = Clock::now();
+    if (now - searchInfo.lastReport < chrono::milliseconds(CURRMOVE_INTERVAL_MS)) return;
+    searchInfo.lastReport = now;
+    long elapsed = chrono::duration_cast<chrono::milliseconds>(now - searchInfo.start).count();
+    char line[160];
+    snprintf(line, sizeof(line), "info depth %d currmove %s currmovenumber %d nodes %llu nps %llu time %ld",
+             searchInfo.rootDepth, uci::moveToUci(searchInfo.currMove).c_str(), searchInfo.currMoveNumber,
+             static_cast<unsigned long long>(nodesAnalyzed),
+             static_cast<unsigned long long>(nodesAnalyzed * 1000 / max(1L, elapsed)), elapsed);
+    uciOutput(line, false);
+}
+
+short black(Board &board, SearchStack *ss, short depth, short alpha, short beta, Move &bestMove, short currentEval, PositionTable &positionCounts, short min_depth,  short max_depth);
+short white(Board &board, SearchStack *ss, short depth, short alpha, short beta, Move &bestMove, short currentEval, PositionTable &positionCounts, short min_depth,  short max_depth) {
+    ALLOC_PHASE(NODE);
+    ++nodesAnalyzed;
+    ss->pvLength = 0;
+    ss->staticEval = currentEval;
+    searchInfo.selDepth = max(searchInfo.selDepth, ss->ply);
+    if (ss->ply >= MAX_PLY - 1) return currentEval;
+    TRACE_EVENT(NODE, ss->ply, depth, currentEval);
+    if ((nodesAnalyzed & 1023) == 0) reportProgress();
+    if (searchInfo.aborted || ((nodesAnalyzed & (LIMIT_CHECK_INTERVAL - 1)) == 0 && limitReached())) return currentEval;
+    if (depth >= min_depth) ++searchStats.qnodes;
 
     // Terminal condition 1: 50 moves rule
     if (board.isHalfMoveDraw()){
@@ -134,12 +499,17 @@ short white(Board &board, short depth, short alpha, short beta, Move &bestMove,
     }
 
     // Terminal condition 2 : triple repetition
-    uint64_t zobrist_w = board.zobrist() & (HASH_TABLE_SIZE - 1);
+    uint64_t zobrist_w = positionCounts.index(board.zobrist());
     uint8_t rep = positionCounts[zobrist_w];
+    ++searchStats.repetitionProbes;
+    if (rep) ++searchStats.repetitionHits;
     if (rep == 2) return 0;
 
-    Movelist unordered_moves;
-    movegen::legalmoves(unordered_moves, board);
+    Movelist &unordered_moves = ss->legal;
+    {
+        PROFILE_SCOPE(MOVEGEN);
+        movegen::legalmoves(unordered_moves, board);
+    }
 
     // Terminal condition 3: no moves allowed (received checkmate or stalemate)
     if (unordered_moves.empty()){
@@ -150,21 +520,43 @@ short white(Board &board, short depth, short alpha, short beta, Move &bestMove,
 
     bestMove = unordered_moves[0];
 
-    // Terminal condition 4: max depth reached
+    // Terminal condition 4: position resolved by the endgame tablebases
+    int wdl;
+    if (depth > 0 && Syzygy::largest() && Syzygy::probeWDL(board, wdl)) {
+        ++searchStats.tablebaseHits;
+        TRACE_EVENT(TABLEBASE, ss->ply, wdl, 1);
+        if (wdl > 1) return TB_WIN_SCORE - depth;
+        if (wdl < -1) return -TB_WIN_SCORE + depth;
+        return 0; // Draws, including results spoiled by the 50 moves rule
+    }
+
+    // Terminal condition 5: position resolved by the built-in bitbases
+    if (depth > 0 && Bitbases::probe(board, wdl)) {
+        ++searchStats.tablebaseHits;
+        TRACE_EVENT(TABLEBASE, ss->ply, wdl, 2);
+        if (wdl > 0) return bitbaseWinScore(board, Color::WHITE) - depth;
+        if (wdl < 0) return -bitbaseWinScore(board, Color::BLACK) + depth;
+        return 0;
+    }
+
+    // Terminal condition 6: max depth reached
     if (depth == max_depth) return currentEval+10;
 
     bool in_check = board.inCheck();
 
     // Null move pruning (inactive in endgames)
-    if (currentStage != GameStage::END && currentEval - 100 > beta && !in_check && min_depth - depth > 2) {   
+    if (currentStage != GameStage::END && currentEval - NULL_MOVE_MARGIN > beta && !in_check && min_depth - depth > NULL_MOVE_REDUCTION) {   
         board.makeNullMove();
-        Movelist moves_aux;                                               
+        Movelist &moves_aux = ss->nullReplies;
         movegen::legalmoves(moves_aux, board);
         if (!moves_aux.empty()){
-            short new_min_depth = min_depth - depth - 2;
+            short new_min_depth = min_depth - depth - NULL_MOVE_REDUCTION;
             short new_max_depth = min_depth - depth;
-            short null_move_score = black(board, 0, beta-1, beta, bestMove, currentEval, positionCounts, new_min_depth, new_max_depth); // Give turn away, small window for efficiency
+            ++searchStats.nullMoveTries;
+            short null_move_score = black(board, ss + 1, 0, beta-1, beta, bestMove, currentEval, positionCounts, new_min_depth, new_max_depth); // Give turn away, small window for efficiency
             if (null_move_score >= beta){
+                ++searchStats.nullMoveCutoffs;
+                TRACE_EVENT(NULL_CUTOFF, ss->ply, depth, null_move_score);
                 board.unmakeNullMove();
                 return null_move_score;                                                                                                 // Return null_move score
             }
@@ -174,14 +566,16 @@ short white(Board &board, short depth, short alpha, short beta, Move &bestMove,
     }
 
     // Move ordering
-    Movelist queen_promotion;
-    Movelist check_and_capture;
-    Movelist check;
-    Movelist good_capture;
-    Movelist bad_capture;
-    Movelist quiet;
+    moveBuckets.clear();
+    Movelist &queen_promotion = moveBuckets.queenPromotion;
+    Movelist &check_and_capture = moveBuckets.checkAndCapture;
+    Movelist &check = moveBuckets.check;
+    Movelist &good_capture = moveBuckets.goodCapture;
+    Movelist &bad_capture = moveBuckets.badCapture;
+    Movelist &quiet = moveBuckets.quiet;
 
     for (const auto& move : unordered_moves){ 
+        PROFILE_SCOPE(ORDERING); // Per move classified
         uint16_t mov_type = move.typeOf();
         board.makeMove(move);
         bool is_check = board.inCheck();
@@ -202,7 +596,8 @@ short white(Board &board, short depth, short alpha, short beta, Move &bestMove,
         else quiet.add(move);
     }
 
-    Movelist moves;
+    Movelist &moves = ss->ordered;
+    moves.clear();
     for (const auto& m : queen_promotion) moves.add(m);
     for (const auto& m : check_and_capture) moves.add(m);
     for (const auto& m : good_capture) moves.add(m);
@@ -217,19 +612,30 @@ short white(Board &board, short depth, short alpha, short beta, Move &bestMove,
         for (const auto& m : quiet) moves.add(m); // If in check or min_depth not reached, analyze all movements
     }
     else { // Not in check, min_depth reached 
-        if (currentEval-10 >= beta) return currentEval-10;
-        else best = currentEval-10; // Standing pat
+        if (currentEval - STAND_PAT_MARGIN >= beta) {
+            ++searchStats.standPatCutoffs;
+            return currentEval - STAND_PAT_MARGIN;
+        }
+        else best = currentEval - STAND_PAT_MARGIN; // Standing pat
     }
 
-    Move dummy;
+    int moveNumber = 0;
+    if (!moves.empty()) ++searchStats.expandedNodes;
     for (auto &move : moves) {
         short evalDelta = 0;
+        ++moveNumber;
+        ++searchStats.movesSearched;
+        ss->currentMove = move;
+        if (ss->ply == 0) {
+            searchInfo.currMove = move;
+            searchInfo.currMoveNumber = moveNumber;
+        }
 
         // Backup pawn structure
-        unsigned char backup_white_pawns = white_pawns;
-        unsigned char backup_black_pawns = black_pawns;
-        vector<short> backup_white_pawn_counts = white_pawn_counts;
-        vector<short> backup_black_pawn_counts = black_pawn_counts;
+        ss->whitePawns = white_pawns;
+        ss->blackPawns = black_pawns;
+        ss->whitePawnCounts = white_pawn_counts;
+        ss->blackPawnCounts = black_pawn_counts;
 
         // Calculate the change in evaluation caused by the move
         evalDelta = evaluateBoard(board) - currentEval;
@@ -237,15 +643,15 @@ short white(Board &board, short depth, short alpha, short beta, Move &bestMove,
 
         board.makeMove(move);
         positionCounts[zobrist_w] += 1;
-        short score = black(board, depth + 1, alpha, beta, dummy, currentEval, positionCounts, min_depth, max_depth);
+        short score = black(board, ss + 1, depth + 1, alpha, beta, ss->childBest, currentEval, positionCounts, min_depth, max_depth);
         positionCounts[zobrist_w] -= 1;
         board.unmakeMove(move);
 
         // Restore pawn structure
-        white_pawns = backup_white_pawns;
-        black_pawns = backup_black_pawns;
-        white_pawn_counts = backup_white_pawn_counts;
-        black_pawn_counts = backup_black_pawn_counts;
+        white_pawns = ss->whitePawns;
+        black_pawns = ss->blackPawns;
+        white_pawn_counts = ss->whitePawnCounts;
+        black_pawn_counts = ss->blackPawnCounts;
 
         // Restore the evaluation to its previous state
         currentEval -= evalDelta;
@@ -253,9 +659,14 @@ short white(Board &board, short depth, short alpha, short beta, Move &bestMove,
         if (score > best) {
             best = score;
             bestMove = move;
+            updatePV(ss, move);
         }
+        else if (best == -INFINITY_VAL && ss->pvLength == 0) updatePV(ss, move); // Every move so far is mated: show the line
         alpha = max(alpha, score);
         if (alpha >= beta) {
+            ++searchStats.betaCutoffs;
+            TRACE_EVENT(CUTOFF, ss->ply, moveNumber, score);
+            if (moveNumber == 1) ++searchStats.firstMoveCutoffs;
             break;
         }
     }
@@ -263,10 +674,17 @@ short white(Board &board, short depth, short alpha, short beta, Move &bestMove,
 }
 
 
-short black(Board &board, short depth, short alpha, short beta, Move &bestMove, short currentEval, vector<uint8_t> &positionCounts, short min_depth,  short max_depth){
-    #ifdef DEBUG
-        ++nodesAnalyzed; // Debug: count node analyzed for black search
-    #endif
+short black(Board &board, SearchStack *ss, short depth, short alpha, short beta, Move &bestMove, short currentEval, PositionTable &positionCounts, short min_depth,  short max_depth){
+    ALLOC_PHASE(NODE);
+    ++nodesAnalyzed;
+    ss->pvLength = 0;
+    ss->staticEval = currentEval;
+    searchInfo.selDepth = max(searchInfo.selDepth, ss->ply);
+    if (ss->ply >= MAX_PLY - 1) return currentEval;
+    TRACE_EVENT(NODE, ss->ply, depth, currentEval);
+    if ((nodesAnalyzed & 1023) == 0) reportProgress();
+    if (searchInfo.aborted || ((nodesAnalyzed & (LIMIT_CHECK_INTERVAL - 1)) == 0 && limitReached())) return currentEval;
+    if (depth >= min_depth) ++searchStats.qnodes;
     
     // Terminal condition 1: 50 moves rule
     if (board.isHalfMoveDraw()){
@@ -276,12 +694,17 @@ short black(Board &board, short depth, short alpha, short beta, Move &bestMove,
     }
 
     // Terminal condition 2 : triple repetition
-    uint64_t zobrist_w = board.zobrist() & (HASH_TABLE_SIZE - 1);
+    uint64_t zobrist_w = positionCounts.index(board.zobrist());
     uint8_t rep = positionCounts[zobrist_w];
+    ++searchStats.repetitionProbes;
+    if (rep) ++searchStats.repetitionHits;
     if (rep == 2) return 0;
 
-    Movelist unordered_moves;
-    movegen::legalmoves(unordered_moves, board);
+    Movelist &unordered_moves = ss->legal;
+    {
+        PROFILE_SCOPE(MOVEGEN);
+        movegen::legalmoves(unordered_moves, board);
+    }
 
     // Terminal condition 3: no moves allowed (received checkmate or stalemate)
     if (unordered_moves.empty()){
@@ -292,20 +715,40 @@ short black(Board &board, short depth, short alpha, short beta, Move &bestMove,
 
     bestMove = unordered_moves[0];
 
+    // Tablebase probe (scores are from white's point of view)
+    int wdl;
+    if (depth > 0 && Syzygy::largest() && Syzygy::probeWDL(board, wdl)) {
+        ++searchStats.tablebaseHits;
+        TRACE_EVENT(TABLEBASE, ss->ply, wdl, 1);
+        if (wdl > 1) return -TB_WIN_SCORE + depth;
+        if (wdl < -1) return TB_WIN_SCORE - depth;
+        return 0;
+    }
+    if (depth > 0 && Bitbases::probe(board, wdl)) {
+        ++searchStats.tablebaseHits;
+        TRACE_EVENT(TABLEBASE, ss->ply, wdl, 2);
+        if (wdl > 0) return -bitbaseWinScore(board, Color::BLACK) + depth;
+        if (wdl < 0) return bitbaseWinScore(board, Color::WHITE) - depth;
+        return 0;
+    }
+
     if (depth == max_depth) return currentEval - 10; //Max depth
 
     bool in_check = board.inCheck();
 
     // Null move pruning (inactive in endgames)
-    if (currentStage != GameStage::END && currentEval + 100 < alpha && !in_check && min_depth - depth > 2) {
+    if (currentStage != GameStage::END && currentEval + NULL_MOVE_MARGIN < alpha && !in_check && min_depth - depth > NULL_MOVE_REDUCTION) {
         board.makeNullMove();
-        Movelist moves_aux;                                               
+        Movelist &moves_aux = ss->nullReplies;
         movegen::legalmoves(moves_aux, board);
         if (!moves_aux.empty()){
-            short new_min_depth = min_depth - depth - 2;
+            short new_min_depth = min_depth - depth - NULL_MOVE_REDUCTION;
             short new_max_depth = min_depth - depth;
-            short null_move_score = white(board, 0, alpha, alpha+1, bestMove, currentEval, positionCounts, new_min_depth, new_max_depth); // Give turn away, small window for efficiency
+            ++searchStats.nullMoveTries;
+            short null_move_score = white(board, ss + 1, 0, alpha, alpha+1, bestMove, currentEval, positionCounts, new_min_depth, new_max_depth); // Give turn away, small window for efficiency
             if (null_move_score <= alpha){
+                ++searchStats.nullMoveCutoffs;
+                TRACE_EVENT(NULL_CUTOFF, ss->ply, depth, null_move_score);
                 board.unmakeNullMove();
                 return null_move_score;                                                                       // Return null_move score
             }
@@ -315,14 +758,16 @@ short black(Board &board, short depth, short alpha, short beta, Move &bestMove,
     }
 
     // Move ordering
-    Movelist queen_promotion;
-    Movelist check_and_capture;
-    Movelist check;
-    Movelist good_capture;
-    Movelist bad_capture;
-    Movelist quiet;
+    moveBuckets.clear();
+    Movelist &queen_promotion = moveBuckets.queenPromotion;
+    Movelist &check_and_capture = moveBuckets.checkAndCapture;
+    Movelist &check = moveBuckets.check;
+    Movelist &good_capture = moveBuckets.goodCapture;
+    Movelist &bad_capture = moveBuckets.badCapture;
+    Movelist &quiet = moveBuckets.quiet;
 
     for (const auto& move : unordered_moves){ 
+        PROFILE_SCOPE(ORDERING); // Per move classified
         uint16_t mov_type = move.typeOf();
         board.makeMove(move);
         bool is_check = board.inCheck();
@@ -343,7 +788,8 @@ short black(Board &board, short depth, short alpha, short beta, Move &bestMove,
         else quiet.add(move);
     }
 
-    Movelist moves;
+    Movelist &moves = ss->ordered;
+    moves.clear();
     for (const auto& m : queen_promotion) moves.add(m);
     for (const auto& m : check_and_capture) moves.add(m);
     for (const auto& m : good_capture) moves.add(m);
@@ -356,19 +802,30 @@ short black(Board &board, short depth, short alpha, short beta, Move &bestMove,
         for (const auto& m : quiet) moves.add(m); // If in check or min_depth not reached, analyze all movements
     }
     else { // Not in check, min_depth reached 
-        if (currentEval+10 <= alpha) return currentEval+10;
-        else best = currentEval+10; // Standing pat
+        if (currentEval + STAND_PAT_MARGIN <= alpha) {
+            ++searchStats.standPatCutoffs;
+            return currentEval + STAND_PAT_MARGIN;
+        }
+        else best = currentEval + STAND_PAT_MARGIN; // Standing pat
     }
 
-    Move dummy;
+    int moveNumber = 0;
+    if (!moves.empty()) ++searchStats.expandedNodes;
     for (auto &move : moves) {
         short evalDelta = 0;
+        ++moveNumber;
+        ++searchStats.movesSearched;
+        ss->currentMove = move;
+        if (ss->ply == 0) {
+            searchInfo.currMove = move;
+            searchInfo.currMoveNumber = moveNumber;
+        }
 
         // Backup pawn structure
-        unsigned char backup_white_pawns = white_pawns;
-        unsigned char backup_black_pawns = black_pawns;
-        vector<short> backup_white_pawn_counts = white_pawn_counts;
-        vector<short> backup_black_pawn_counts = black_pawn_counts;
+        ss->whitePawns = white_pawns;
+        ss->blackPawns = black_pawns;
+        ss->whitePawnCounts = white_pawn_counts;
+        ss->blackPawnCounts = black_pawn_counts;
 
         // Calculate the change in evaluation caused by the move
         evalDelta = evaluateBoard(board) - currentEval;
@@ -376,15 +833,15 @@ short black(Board &board, short depth, short alpha, short beta, Move &bestMove,
 
         board.makeMove(move);
         positionCounts[zobrist_w] += 1;
-        short score = white(board, depth + 1, alpha, beta, dummy, currentEval, positionCounts, min_depth, max_depth);
+        short score = white(board, ss + 1, depth + 1, alpha, beta, ss->childBest, currentEval, positionCounts, min_depth, max_depth);
         positionCounts[zobrist_w] -= 1;
         board.unmakeMove(move);
 
         // Restore pawn structure
-        white_pawns = backup_white_pawns;
-        black_pawns = backup_black_pawns;
-        white_pawn_counts = backup_white_pawn_counts;
-        black_pawn_counts = backup_black_pawn_counts;
+        white_pawns = ss->whitePawns;
+        black_pawns = ss->blackPawns;
+        white_pawn_counts = ss->whitePawnCounts;
+        black_pawn_counts = ss->blackPawnCounts;
 
         // Restore the evaluation to its previous state
         currentEval -= evalDelta;
@@ -392,15 +849,365 @@ short black(Board &board, short depth, short alpha, short beta, Move &bestMove,
         if (score < best) {
             best = score;
             bestMove = move;
+            updatePV(ss, move);
         }
+        else if (best == INFINITY_VAL && ss->pvLength == 0) updatePV(ss, move); // Every move so far is mated: show the line
         beta = min(beta, score);
         if (alpha >= beta) {
+            ++searchStats.betaCutoffs;
+            TRACE_EVENT(CUTOFF, ss->ply, moveNumber, score);
+            if (moveNumber == 1) ++searchStats.firstMoveCutoffs;
             break;
         }
     }
     return best;
 }
 
+// One fixed-depth search from the root position, as run by each iteration of `go` and by `bench`
+short searchRoot(Board &board, Move &bestMove, short currentEval, PositionTable &positionCounts, short min_depth, short max_depth) {
+    PROFILE_SCOPE(SEARCH);
+    SearchStack *ss = searchStack;
+    for (int ply = 0; ply < MAX_PLY; ++ply) ss[ply].ply = ply;
+    TRACE_EVENT(SEARCH_START, 0, min_depth, max_depth);
+    short score;
+    if (board.sideToMove() == Color::WHITE)
+        score = white(board, ss, 0, -INFINITY_VAL, INFINITY_VAL, bestMove, currentEval, positionCounts, min_depth, max_depth);
+    else
+        score = black(board, ss, 0, -INFINITY_VAL, INFINITY_VAL, bestMove, currentEval, positionCounts, min_depth, max_depth);
+    TRACE_EVENT(SEARCH_END, 0, score, static_cast<int32_t>(nodesAnalyzed));
+    return score;
+}
+
+//-------------------------------------------------------------
+// Bench: fixed positions searched to a fixed depth. The total node count is deterministic
+// and works as a signature of the search: a change that should not alter the search must
+// not alter it.
+//-------------------------------------------------------------
+constexpr int BENCH_DEPTH = 1;
+constexpr int BENCH_EXTENSION = 9;  // Max depth over min depth, as in the default first iteration (5, 14)
+
+const vector<string> BENCH_POSITIONS = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/2pb1ppp/2pp1q2/p7/1nP1B3/1P2P3/P2N1PPP/R2QK2R w KQkq a6 0 14",
+    "4rrk1/2p1b1p1/p1p3q1/4p3/2P2n1p/1P1NR2P/PB3PP1/3R1QK1 b - - 2 24",
+    "r3qbrk/6p1/2b2pPp/p3pP1Q/PpPpP2P/3P1B2/2PB3K/R5R1 w - - 16 42",
+    "6k1/1R3p2/6p1/2Bp3p/3P2q1/P7/1P2rQ1K/5R2 b - - 4 44",
+    "8/8/1p2k1p1/3p3p/1p1P1P1P/1P2PK2/8/8 w - - 3 54",
+    "7r/2p3k1/1p1p1qp1/1P1Bp3/p1P2r1P/P7/4R3/Q4RK1 w - - 0 36",
+    "r1bq1rk1/pp2b1pp/n1pp1n2/3P1p2/2P1p3/2N1P2N/PP2BPPP/R1BQ1RK1 b - - 2 10",
+    "3r3k/2r4p/1p1b3q/p4P2/P2Pp3/1B2P3/3BQ1RP/6K1 w - - 3 87",
+    "2r4r/1p4k1/1Pnp4/3Qb1pq/8/4BpPp/5P2/2RR1BK1 w - - 0 42",
+    "4q1bk/6b1/7p/p1p4p/PNPpP2P/KN4P1/3Q4/4R3 b - - 0 37",
+    "2q3r1/1r2pk2/pp3pp1/2pP3p/P1Pb1BbP/1P4Q1/R3NPP1/4R1K1 w - - 2 34",
+    "1r2r2k/1b4q1/pp5p/2pPp1p1/P3Pn2/1P1B1Q1P/2R3P1/4BR1K b - - 1 37",
+    "r3kbbr/pp1n1p1P/3ppnp1/q5N1/1P1pP3/P1N1B3/2P1QP2/R3KB1R b KQkq b3 0 17",
+    "8/6pk/2b1Rp2/3r4/1R1B2PP/P5K1/8/2r5 b - - 16 42",
+    "1r4k1/4ppb1/2n1b1qp/pB4p1/1n1BP1P1/7P/2PNQPK1/3RN3 w - - 8 29",
+    "8/p2B4/PkP5/4p1pK/4Pb1p/5P2/8/8 w - - 29 68",
+    "3r4/ppq1ppkp/4bnp1/2pN4/2P1P3/1P4P1/PQ3PBP/R4K2 b - - 2 20",
+    "5rr1/4n2k/4q2P/P1P2n2/3B1p2/4pP2/2N1P3/1RR1K2Q w - - 1 49",
+    "1r5k/2pq2p1/3p3p/p1pP4/4QP2/PP1R3P/6PK/8 w - - 1 51",
+    "q5k1/5ppp/1r3bn1/1B6/P1N2P2/BQ2P1P1/5K1P/8 b - - 2 34",
+    "r1b2k1r/5n2/p4q2/1ppn1Pp1/3pp1p1/NP2P3/P1PPBK2/1RQN2R1 w - - 0 22",
+    "r1bqk2r/pppp1ppp/5n2/4b3/4P3/P1N5/1PP2PPP/R1BQKB1R w KQkq - 0 5",
+    "r1bqr1k1/pp1p1ppp/2p5/8/3N1Q2/P2BB3/1PP2PPP/R3K2n b Q - 1 12",
+    "r1bq2k1/p4r1p/1pp2pp1/3p4/1P1B3Q/P2B1N2/2P3PP/4R1K1 b - - 2 19",
+    "r4qk1/6r1/1p4p1/2ppBbN1/1p5Q/P7/2P3PP/5RK1 w - - 2 25",
+    "r7/6k1/1p6/2pp1p2/7Q/8/p1P2K1P/8 w - - 0 32",
+    "r3k2r/ppp1pp1p/2nqb1pn/3p4/4P3/2PP4/PP1NBPPP/R2QK1NR w KQkq - 1 5",
+    "3r1rk1/1pp1pn1p/p1n1q1p1/3p4/Q3P3/2P5/PP1NBPPP/4RRK1 w - - 0 12",
+    "5rk1/1pp1pn1p/p3Brp1/8/1n6/5N2/PP3PPP/2R2RK1 w - - 2 20",
+    "8/1p2pk1p/p1p1r1p1/3n4/8/5R2/PP3PPP/4R1K1 b - - 3 27",
+    "8/4pk2/1p1r2p1/p1p4p/Pn5P/3R4/1P3PP1/4RK2 w - - 1 33",
+    "8/5k2/1pnrp1p1/p1p4p/P6P/4R1PK/1P3P2/4R3 b - - 1 38",
+    "8/8/1p1kp1p1/p1pr1n1p/P6P/1R4P1/1P3PK1/1R6 b - - 15 45",
+    "8/8/1p1k2p1/p1prp2p/P2n3P/6P1/1P1R1PK1/4R3 b - - 5 49",
+    "8/8/1p4p1/p1p2k1p/P2npP1P/4K1P1/1P6/3R4 w - - 6 54",
+    "8/8/1p4p1/p1p2k1p/P2n1P1P/4K1P1/1P6/6R1 b - - 6 59",
+    "8/5k2/1p4p1/p1pK3p/P2n1P1P/6P1/1P6/4R3 b - - 14 63",
+    "8/1R6/1p1K1kp1/p6p/P1p2P1P/6P1/1Pn5/8 w - - 0 67",
+    "1rb1rn1k/p3q1bp/2p3p1/2p1p3/2P1P2N/PP1RQNP1/1B3P2/4R1K1 b - - 4 23",
+    "4rrk1/pp1n1pp1/q5p1/P1pP4/2n3P1/7P/1P3PB1/R1BQ1RK1 w - - 3 22",
+    "r2qr1k1/pb1nbppp/1pn1p3/2ppP3/3P4/2PB1NN1/PP3PPP/R1BQR1K1 w - - 4 12",
+    "2r2k2/8/4P1R1/1p6/8/P4K1N/7b/2B5 b - - 0 55",
+    "6k1/5pp1/8/2bKP2P/2P5/p4PNb/B7/8 b - - 1 44",
+    "2rqr1k1/1p3p1p/p2p2p1/P1nPb3/2B1P3/5P2/1PQ2NPP/R1R4K w - - 3 25",
+    "r1b2rk1/p1q1ppbp/6p1/2Q5/8/4BP2/PPP3PP/2KR1B1R b - - 2 14",
+    "6r1/5k2/p1b1r2p/1pB1p1p1/1Pp3PP/2P1R1K1/2P2P2/3R4 w - - 1 36",
+    "rnbqkb1r/pppppppp/5n2/8/2PP4/8/PP2PPPP/RNBQKBNR b KQkq c3 0 2",
+    "2rr2k1/1p4bp/p1q1p1p1/4Pp1n/2PB4/1PN3P1/P3Q2P/2RR2K1 w - f6 0 20",
+    "3br1k1/p1pn3p/1p3n2/5pNq/2P1p3/1PN3PP/P2Q1PB1/4R1K1 w - - 0 23",
+    "2r2b2/5p2/5k2/p1r1pP2/P2pB3/1P3P2/K1P3R1/7R w - - 23 93",
+};
+
+//-------------------------------------------------------------
+// Limited search for the test suites (solve, epd): iterative deepening from min depth 1 under
+// a time and node budget. All search state is thread_local, so each worker thread of a suite
+// is an engine instance of its own.
+//-------------------------------------------------------------
+struct SearchLimits {
+    long movetime = 0;      // ms per position, 0 for none
+    uint64_t nodes = 0;     // Per position, 0 for none
+    int depth = 0;          // Last min depth, 0 for none
+};
+
+struct Iteration {
+    int depth = 0;
+    short score = 0;        // White's point of view, as in the search
+    Move bestMove;
+    vector<Move> pv;
+    long time = 0;          // ms from the start to the end of this iteration
+    uint64_t nodes = 0;     // Nodes from the start to the end of this iteration
+};
+
+// onIteration(const Iteration&) is called after each completed iteration and returns false to
+// stop. An iteration cut short by the limits is thrown away. Leaves the node count in nodesAnalyzed.
+template <typename Callback>
+void searchLimited(Board &board, const SearchLimits &limits, PositionTable &positionCounts, Callback onIteration) {
+    auto start = Clock::now();
+    nodesAnalyzed = 0;
+    searchInfo = SearchInfo();
+    searchInfo.start = searchInfo.lastReport = start;
+    searchInfo.nodeLimit = limits.nodes;
+    searchInfo.timeLimit = limits.movetime > 0;
+    searchInfo.deadline = start + chrono::milliseconds(limits.movetime);
+
+    short currentEval = evaluateBoard(board);
+    for (int depth = 1; !limits.depth || depth <= limits.depth; ++depth) {
+        Iteration iteration;
+        iteration.depth = searchInfo.rootDepth = depth;
+        searchInfo.selDepth = 0;
+        iteration.score = searchRoot(board, iteration.bestMove, currentEval, positionCounts, depth, depth + BENCH_EXTENSION);
+        if (searchInfo.aborted) break;
+        iteration.pv.assign(searchStack[0].pv, searchStack[0].pv + searchStack[0].pvLength);
+        iteration.time = chrono::duration_cast<chrono::milliseconds>(Clock::now() - start).count();
+        iteration.nodes = nodesAnalyzed;
+        if (!onIteration(iteration)) break;
+    }
+}
+
+// Moves of the side to move in `pv` if it is legal and ends in checkmate of the other side, else 0
+int verifiedMate(Board board, const vector<Move> &pv) {
+    Color winner = board.sideToMove();
+    Movelist legal;
+    for (const Move &move : pv) {
+        movegen::legalmoves(legal, board);
+        if (find(legal.begin(), legal.end(), move) == legal.end()) return 0;
+        board.makeMove(move);
+    }
+    movegen::legalmoves(legal, board);
+    if (!legal.empty() || !board.inCheck() || board.sideToMove() == winner) return 0;
+    return static_cast<int>(pv.size() + 1) / 2;
+}
+
+// Nearest rank percentile of sorted values, 0 when there are none
+long percentile(const vector<long> &sorted, double p) {
+    if (sorted.empty()) return 0;
+    size_t rank = static_cast<size_t>(ceil(p * sorted.size()));
+    return sorted[min(sorted.size(), max<size_t>(rank, 1)) - 1];
+}
+
+// Mate problems as in Tests/Data/Mates: blank line separated entries of a header line and a FEN.
+// A directory stands for all its Mates_in_<N>.txt files, in order of N.
+struct MateProblem {
+    string fen;
+    string source;          // File name
+    int mateIn = 0;         // From a Mates_in_<N> file name, 0 when unknown
+};
+
+vector<MateProblem> loadMateProblems(const string &path, size_t perFile) {
+    namespace fs = std::filesystem;
+    vector<fs::path> files;
+    if (fs::is_directory(path)) {
+        for (const auto &entry : fs::directory_iterator(path))
+            if (entry.path().extension() == ".txt" && entry.path().filename().string().rfind("Mates_in_", 0) == 0)
+                files.push_back(entry.path());
+    }
+    else files.push_back(path);
+
+    auto mateIn = [](const fs::path &file) {
+        string name = file.stem().string();
+        size_t pos = name.rfind('_');
+        return pos != string::npos && isdigit(static_cast<unsigned char>(name[pos + 1])) ? stoi(name.substr(pos + 1)) : 0;
+    };
+    sort(files.begin(), files.end(), [&](const fs::path &a, const fs::path &b) { return mateIn(a) < mateIn(b); });
+
+    vector<MateProblem> problems;
+    for (const auto &file : files) {
+        ifstream in(file);
+        if (!in) {
+            LOG_WARN("Could not open " << file.string());
+            continue;
+        }
+        size_t loaded = 0;
+        string line;
+        while (getline(in, line) && (!perFile || loaded < perFile)) {
+            if (count(line.begin(), line.end(), '/') != 7) continue;  // Headers and blank lines
+            while (!line.empty() && isspace(static_cast<unsigned char>(line.back()))) line.pop_back();
+            problems.push_back({line, file.filename().string(), mateIn(file)});
+            ++loaded;
+        }
+    }
+    return problems;
+}
+
+// EPD suites (WAC, STS...): the first four FEN fields, then `opcode operands;` operations.
+// bm and am list the expected and the avoided moves in SAN (UCI notation is accepted too),
+// id names the position, hmvc and fmvn complete the FEN.
+struct EpdPosition {
+    string id;
+    string fen;
+    vector<Move> best, avoid;
+    vector<string> bestText, avoidText;     // As written in the file
+};
+
+// A legal move of the position written in SAN or UCI notation
+bool parseMoveText(const Board &board, const string &text, Move &move) {
+    try {
+        move = uci::parseSan(board, text);
+    } catch (const exception &) {
+        move = Move(Move::NO_MOVE);
+    }
+    if (move.move() == Move::NO_MOVE && text.size() >= 4 && text.size() <= 5 &&
+        text[0] >= 'a' && text[0] <= 'h' && text[1] >= '1' && text[1] <= '8')
+        move = uci::uciToMove(board, text);
+    if (move.move() == Move::NO_MOVE) return false;
+    Movelist legal;
+    movegen::legalmoves(legal, board);
+    return find(legal.begin(), legal.end(), move) != legal.end();
+}
+
+bool parseEpd(const string &line, EpdPosition &position) {
+    istringstream in(line);
+    string placement, side, castling, enPassant;
+    if (!(in >> placement >> side >> castling >> enPassant)) return false;
+    string halfmoves = "0", fullmoves = "1";
+    vector<pair<string, vector<string>>> operations;
+    string operation;
+    while (getline(in, operation, ';')) {
+        istringstream ops(operation);
+        string opcode, operand;
+        if (!(ops >> opcode)) continue;
+        vector<string> operands;
+        while (ops >> operand) operands.push_back(operand);
+        if (opcode == "hmvc" && !operands.empty()) halfmoves = operands[0];
+        else if (opcode == "fmvn" && !operands.empty()) fullmoves = operands[0];
+        else operations.push_back({opcode, operands});
+    }
+
+    position.fen = placement + " " + side + " " + castling + " " + enPassant + " " + halfmoves + " " + fullmoves;
+    Board board(position.fen);
+    for (const auto &[opcode, operands] : operations) {
+        if (opcode == "id") {
+            for (const auto &word : operands) position.id += (position.id.empty() ? "" : " ") + word;
+            position.id.erase(remove(position.id.begin(), position.id.end(), '"'), position.id.end());
+            continue;
+        }
+        if (opcode != "bm" && opcode != "am") continue;
+        for (const auto &text : operands) {
+            Move move;
+            if (!parseMoveText(board, text, move)) {
+                LOG_WARN("Illegal or unknown move " << text << " in " << position.fen);
+                continue;
+            }
+            (opcode == "bm" ? position.best : position.avoid).push_back(move);
+            (opcode == "bm" ? position.bestText : position.avoidText).push_back(text);
+        }
+    }
+    return !position.best.empty() || !position.avoid.empty();
+}
+
+string jsonString(const string &text) {
+    string out = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out + "\"";
+}
+
+// Input of the analyze command: PGN files (first line a tag pair or move 1) and FEN lists (one
+// FEN or EPD line per line). A game is one unit of work, the moves played from its start
+// position; a FEN is a unit without moves.
+struct AnalysisGame {
+    string source;          // File name
+    int number = 0;         // Game number in a PGN file, line number in a FEN list
+    string fen;             // Start position
+    vector<Move> moves;
+};
+
+class AnalysisVisitor : public pgn::Visitor {
+public:
+    vector<AnalysisGame> games;
+    string source;
+
+    void startPgn() override {
+        game = AnalysisGame{source, ++number, Board().getFen(), {}};
+        board = Board();
+    }
+
+    void header(string_view key, string_view value) override {
+        if (key == "FEN") {
+            game.fen = string(value);
+            board = Board(game.fen);
+        }
+    }
+
+    void startMoves() override {}
+
+    void move(string_view san, string_view) override {
+        Move move;
+        if (!parseMoveText(board, string(san), move)) {
+            LOG_WARN("Illegal or unknown move " << san << " in game " << number << " of " << source << ", rest skipped");
+            skipPgn(true);
+            return;
+        }
+        game.moves.push_back(move);
+        board.makeMove(move);
+    }
+
+    void endPgn() override {
+        if (!game.moves.empty()) games.push_back(std::move(game));
+    }
+
+private:
+    AnalysisGame game;
+    Board board;
+    int number = 0;
+};
+
+vector<AnalysisGame> loadAnalysisGames(const string &path) {
+    ifstream in(path);
+    if (!in) {
+        LOG_WARN("Could not open " << path);
+        return {};
+    }
+    string source = std::filesystem::path(path).filename().string(), line;
+    while (getline(in, line) && line.find_first_not_of(" \t\r") == string::npos) {}
+    bool isPgn = !line.empty() && (line[0] == '[' || line.rfind("1.", 0) == 0);
+    in.clear();
+    in.seekg(0);
+
+    if (isPgn) {
+        AnalysisVisitor visitor;
+        visitor.source = source;
+        pgn::StreamParser parser(in);
+        parser.readGames(visitor);
+        return std::move(visitor.games);
+    }
+    vector<AnalysisGame> games;
+    for (int number = 1; getline(in, line); ++number) {
+        if (count(line.begin(), line.end(), '/') != 7) continue;  // Headers, comments and blank lines
+        istringstream fields(line);
+        string field, fen;
+        for (int i = 0; i < 6 && fields >> field; ++i) {
+            if (i >= 4 && !all_of(field.begin(), field.end(), ::isdigit)) break;   // EPD operations
+            fen += (fen.empty() ? "" : " ") + field;
+        }
+        games.push_back({source, number, fen, {}});
+    }
+    return games;
+}
 
 struct SearchParameters {
     int wtime = 0;
@@ -420,66 +1227,78 @@ struct SearchParameters {
 // Opening Database Structures and Functions
 //-------------------------------------------------------------
 
-// Structure to represent a node in the openings database
-struct OpeningNode {
-    int id;
-    std::string fen;
-    int evaluation;
-    std::string moves;  // Space-separated moves with evaluations
-    std::vector<std::string> pv;  // PV moves stored as a space-delimited string in the database
-};
+// OpeningNode and the OpeningBook service live in opening_book.h: the database is opened
+// once, queried through prepared statements by Zobrist key, and prefetched in the background.
 
-// Helper: tokenize a space-delimited string into a vector of strings.
-std::vector<std::string> tokenize(const std::string& str) {
-    std::istringstream iss(str);
-    std::vector<std::string> tokens;
-    std::string token;
-    while (iss >> token) {
-        tokens.push_back(token);
+//-------------------------------------------------------------
+// Search threads shared by the sessions of a server (serve). Search state is thread_local, so
+// each worker is an engine instance of its own; it also has its own position table, which
+// holds a session's game only while it searches for it. Searches run in the order they come.
+//-------------------------------------------------------------
+thread_local PositionTable* workerCounts = nullptr;
+
+class SearchPool {
+public:
+    SearchPool(int threads, size_t hashMb) {
+        for (int t = 0; t < threads; ++t) workers.emplace_back(&SearchPool::work, this, hashMb);
     }
-    return tokens;
-}
 
-// Query the opening database for a specific FEN using the new schema.
-OpeningNode queryOpeningDatabase(sqlite3* db, const std::string& fen) {
-    OpeningNode node;
-    sqlite3_stmt* stmt;
-    
-    // New query: we now select id, fen, evaluation, moves, and pv from the nodes table.
-    const char* node_sql = 
-        "SELECT id, fen, evaluation, moves, pv "
-        "FROM nodes "
-        "WHERE fen = ?;";
-    
-    if (sqlite3_prepare_v2(db, node_sql, -1, &stmt, nullptr) != SQLITE_OK) {
-        DEBUG_PRINT("[DEBUG] Failed to prepare node SQL statement: " << sqlite3_errmsg(db));
-        return node;
+    ~SearchPool() {
+        {
+            lock_guard<mutex> lock(jobs_mutex);
+            stopping = true;
+        }
+        jobs_cv.notify_all();
+        for (auto& w : workers) w.join();
     }
-    
-    sqlite3_bind_text(stmt, 1, fen.c_str(), -1, SQLITE_STATIC);
-    
-    if (sqlite3_step(stmt) == SQLITE_ROW) {
-        node.id = sqlite3_column_int(stmt, 0);
-        node.fen = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
-        node.evaluation = sqlite3_column_int(stmt, 2);
-        node.moves = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3));
-        std::string pvStr = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 4));
-        node.pv = tokenize(pvStr);
+
+    future<void> submit(function<void()> job) {
+        packaged_task<void()> task(std::move(job));
+        future<void> done = task.get_future();
+        {
+            lock_guard<mutex> lock(jobs_mutex);
+            jobs.push_back(std::move(task));
+        }
+        jobs_cv.notify_one();
+        return done;
     }
-    
-    sqlite3_finalize(stmt);
-    return node;
-}
 
-// Given a position, look up the corresponding node in the openings database
-const OpeningNode* lookupOpening(const std::vector<OpeningNode>& nodes, const std::string& fen) {
-    for (const auto& node : nodes) {
-        if (node.fen == fen) {
-            return &node;
+private:
+    vector<thread> workers;
+    deque<packaged_task<void()>> jobs;
+    mutex jobs_mutex;
+    condition_variable jobs_cv;
+    bool stopping = false;
+
+    void work(size_t hashMb) {
+        PositionTable counts(hashMb);
+        workerCounts = &counts;
+        for (;;) {
+            packaged_task<void()> job;
+            {
+                unique_lock<mutex> lock(jobs_mutex);
+                jobs_cv.wait(lock, [&] { return stopping || !jobs.empty(); });
+                if (jobs.empty()) return;
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            job();
         }
     }
-    return nullptr;
-}
+};
+
+// The positions of a session's game counted in a worker's table for the time of one search
+struct BorrowedHistory {
+    PositionTable& counts;
+    vector<uint64_t> keys;
+
+    BorrowedHistory(PositionTable& counts, const vector<uint64_t>& keys) : counts(counts), keys(keys) {
+        for (uint64_t key : keys) counts[counts.index(key)] += 1;
+    }
+    ~BorrowedHistory() {
+        for (uint64_t key : keys) counts[counts.index(key)] -= 1;
+    }
+};
 
 //-------------------------------------------------------------
 // UCIHandler: Modified to use the openings database.
@@ -504,34 +1323,52 @@ private:
         bool ponder = false;
     } search_params;
     
-    vector<uint8_t> positionCounts = vector<uint8_t>(HASH_TABLE_SIZE, 0);
+    unique_ptr<PositionTable> positionTable;   // Counts gameKeys; server sessions use their worker's instead
     bool uciChess960 = false;
     
     // Engine options
     unordered_map<string, string> options;
     
     // --- Modified members for the openings database ---
-    sqlite3* opening_db;
-    vector<string> playedMoves;     // Move history in UCI notation.
+    shared_ptr<OpeningBook> book;   // Shared by the sessions of a server
+    string bitbasePath = "bitbases";
+    int bitbaseMen = 3;
+    bool bitbasesReady = false;
+    string statsFile;               // Where the session statistics are written at quit
+    bool perfCounters = false;      // Hardware counters around each go and bench
+    int exitStatus = 0;             // Non-zero once a self-test (alloctest) has failed
+    string positionBase = "startpos";   // "startpos" or the FEN the game started from
+    vector<string> playedMoves;     // Moves played on the board since positionBase, in UCI notation
+    vector<uint64_t> gameKeys;      // Zobrist keys of the positions they left, counted in positionTable
     vector<string> openingPV;       // If a leaf is reached in the book, store the rest of the PV.
     bool hitLeaf = false;           // Track if we've hit a leaf in the book
     Board previous_board;
+
+    // Server sessions (serve): searches go to the shared pool, lines to the session's socket
+    SearchPool* pool = nullptr;
+    OutputChannel* channel = nullptr;
+    long moveTimeLimit = 0;         // Per session cap on the time of a move in ms, 0 for none
+    future<void> pendingSearch;     // The session's search on the pool
+    bool sessionOver = false;
     
 public:
-    UCIHandler() {
+    UCIHandler() : positionTable(make_unique<PositionTable>(HASH_MB)), book(make_shared<OpeningBook>()) {
         // Initialize with a random seed at construction time
         unsigned int seed = std::random_device()();
         rng.seed(seed);
         DEBUG_PRINT("[DEBUG] Random seed initialized to: " << seed);
     }
+
+    // A server session: the book (open), bitbases and network are the server's, loaded once,
+    // and the session itself is little more than its board and move history
+    UCIHandler(shared_ptr<OpeningBook> book, SearchPool* pool, OutputChannel* channel, long moveTimeLimit)
+        : book(std::move(book)), bitbasesReady(true), pool(pool), channel(channel), moveTimeLimit(moveTimeLimit) {
+        rng.seed(std::random_device()());
+    }
     
     // Destructor: join any running search thread.
     ~UCIHandler() {
-        if (search_thread.joinable())
-            search_thread.join();
-        if (opening_db) {
-            sqlite3_close(opening_db);
-        }
+        wait_search();
     }
     
     void run() {
@@ -539,12 +1376,53 @@ public:
         while (getline(cin, line))
             process_command(line);
     }
+
+    // Run a single command, e.g. one given on the command line. Returns the exit status
+    int execute(const string& command) {
+        process_command(command);
+        wait_search();
+        return exitStatus;
+    }
+
+    // Serve a session's connection until the client quits or disconnects
+    void runSession() {
+        outputChannel = channel;
+        string pending;
+        char buffer[4096];
+        while (!sessionOver) {
+            ssize_t n = recv(channel->socket, buffer, sizeof(buffer), 0);
+            if (n <= 0) break;
+            pending.append(buffer, n);
+            size_t end;
+            while (!sessionOver && (end = pending.find('\n')) != string::npos) {
+                string line = pending.substr(0, end);
+                pending.erase(0, end + 1);
+                if (!line.empty() && line.back() == '\r') line.pop_back();
+                process_command(line);
+            }
+        }
+        wait_search();
+        outputChannel = nullptr;
+    }
     
 private:
     void process_command(const string& input) {
         istringstream iss(input);
         string token;
         iss >> token;
+
+        // Sessions share the process: only the game commands, and quit ends the session only
+        if (pool) {
+            static const char* const SESSION_COMMANDS[] = {"uci", "isready", "setoption", "ucinewgame", "position", "go", "stop"};
+            if (token == "quit") {
+                sessionOver = true;
+                return;
+            }
+            if (!token.empty() && find(begin(SESSION_COMMANDS), end(SESSION_COMMANDS), token) == end(SESSION_COMMANDS)) {
+                uciOutput("info string " + token + " is not available in server sessions");
+                return;
+            }
+        }
         
         if (token == "uci")
             handle_uci();
@@ -562,23 +1440,65 @@ private:
             handle_stop();
         else if (token == "quit")
             handle_quit();
+        else if (token == "bench")
+            handle_bench(iss);
+        else if (token == "perft")
+            handle_perft(iss, false);
+        else if (token == "divide")
+            handle_perft(iss, true);
+        else if (token == "stats")
+            handle_stats(iss);
+        else if (token == "alloctest")
+            handle_alloctest(iss);
+        else if (token == "solve")
+            handle_solve(iss);
+        else if (token == "epd")
+            handle_epd(iss);
+        else if (token == "analyze")
+            handle_analyze(iss);
+        else if (token == "serve")
+            handle_serve(iss);
+        else if (token == "datagen")
+            handle_datagen(iss);
+        else if (token == "trace")
+            handle_trace(iss);
+        else if (token == "bitbases")
+            handle_bitbases(iss);
     }
     
     void handle_uci() {
-        cout << "id name Chessape_1.2" << endl;
-        cout << "id author Bernabé Iturralde Jara" << endl;
-        cout << "option name UCI_Chess960 type check default false" << endl;
-        cout << "option name RandomSeed type spin default 0 min 0 max 2147483647" << endl;
-        cout << "uciok" << endl;
+        ostringstream out;   // One write, so a session gets the whole list at once
+        out << "id name Chessape_1.2\n";
+        out << "id author Bernabé Iturralde Jara\n";
+        out << "option name UCI_Chess960 type check default false\n";
+        out << "option name RandomSeed type spin default 0 min 0 max 2147483647\n";
+        out << "option name SyzygyPath type string default <empty>\n";
+        out << "option name SyzygyProbeLimit type spin default 7 min 0 max 7\n";
+        out << "option name BitbasePath type string default bitbases\n";
+        out << "option name BitbaseMen type spin default 3 min 0 max 4\n";
+        out << "option name StatsFile type string default <empty>\n";
+        out << "option name PerfCounters type check default false\n";
+        out << "option name Hash type spin default " << HASH_MB << " min 1 max " << MAX_HASH_MB << "\n";
+        for (const Tunable& tunable : TUNABLES) {
+            if (tunable.integer)
+                out << "option name " << tunable.name << " type spin default " << *tunable.integer << " min "
+                     << tunable.min << " max " << tunable.max << "\n";
+            else
+                out << "option name " << tunable.name << " type string default " << *tunable.real << "\n";
+        }
+        out << "uciok";
+        uciOutput(out.str());
     }
     
     void handle_setoption(istringstream& iss) {
         string word, name, value;
-        while (iss >> word) {
-            if (word == "name")
-                iss >> name;
-            else if (word == "value")
-                iss >> value;
+        iss >> word; // "name"
+        while (iss >> word && word != "value")
+            name += (name.empty() ? "" : " ") + word;
+        getline(iss >> ws, value); // Values such as paths may contain spaces
+        if (pool && name != "UCI_Chess960" && name != "RandomSeed") {
+            uciOutput("info string " + name + " is set for the whole server");
+            return;
         }
         if (name == "UCI_Chess960") {
             uciChess960 = (value == "true" || value == "1");
@@ -588,29 +1508,85 @@ private:
             options["RandomSeed"] = value;
             DEBUG_PRINT("[DEBUG] Random seed set to " << value);
         }
+        else if (name == "SyzygyPath") {
+            int pieces = Syzygy::init(value);
+            LOG_INFO("Syzygy tablebases loaded up to " << pieces << " pieces from " << value);
+        }
+        else if (name == "SyzygyProbeLimit") {
+            long limit;
+            if (!parseSpin(value, 0, 7, limit)) {
+                uciOutput("info string invalid SyzygyProbeLimit: " + value);
+                return;
+            }
+            Syzygy::setProbeLimit(static_cast<int>(limit));
+            LOG_DEBUG("Syzygy probe limit set to " << limit);
+        }
+        else if (name == "BitbasePath" || name == "BitbaseMen") {
+            long men;
+            if (name == "BitbasePath") bitbasePath = value;
+            else if (parseSpin(value, 0, 4, men)) bitbaseMen = static_cast<int>(men);
+            else {
+                uciOutput("info string invalid BitbaseMen: " + value);
+                return;
+            }
+            bitbasesReady = false; // Loaded on the next isready
+        }
+        else if (name == "StatsFile") {
+            statsFile = value;
+        }
+        else if (name == "PerfCounters") {
+            perfCounters = (value == "true" || value == "1");
+        }
+        else if (name == "Hash") {
+            long megabytes;
+            if (!parseSpin(value, 1, MAX_HASH_MB, megabytes)) {
+                uciOutput("info string invalid Hash: " + value);
+                return;
+            }
+            HASH_MB = static_cast<size_t>(megabytes);
+            lock_guard<mutex> lock(board_mutex);    // Not while a search uses the table
+            positionTable->resize(HASH_MB);
+            // Already zero: clearing faults the pages in from every core now, not during the search
+            positionTable->clear(max(1u, thread::hardware_concurrency()));
+            for (uint64_t key : gameKeys) (*positionTable)[positionTable->index(key)] += 1;
+            LOG_DEBUG("Hash set to " << HASH_MB << " MB, " << positionTable->size() << " entries"
+                      << (positionTable->hugePages() ? " on huge pages" : ""));
+        }
+        else if (setTunable(name, value)) {
+            LOG_DEBUG(name << " set to " << value);
+        }
     }
     
     void handle_isready() {
-        try {
-            int rc = sqlite3_open("../../Openings/openings.db", &opening_db);
-            if (rc) {
-                DEBUG_PRINT("[DEBUG] Can't open openings database: " << sqlite3_errmsg(opening_db));
-            } else {
-                DEBUG_PRINT("[DEBUG] Opening database opened successfully");
-            }
-        } catch (const std::exception& e) {
-            DEBUG_PRINT("[DEBUG] Error opening database: " << e.what());
+        load_data();
+        wait_search();
+        uciOutput("readyok");
+    }
+
+    // Server sessions find everything loaded by the server
+    void load_data() {
+        // The book stays open for the whole session; this only opens it the first time
+        if (!pool && !book->isOpen())
+            book->open("../../Openings/openings.db");
+        // Bitbases are only loaded here: generating missing ones takes minutes, far longer than
+        // a GUI waits for readyok, so that is left to the bitbases command
+        if (!bitbasesReady) {
+            int tables = Bitbases::init(bitbasePath, bitbaseMen);
+            if (tables == 0 && bitbaseMen >= 3)
+                LOG_WARN("No bitbases in " << bitbasePath << ": run the bitbases command to generate them");
+            else LOG_INFO(tables << " bitbases loaded from " << bitbasePath);
+            bitbasesReady = true;
         }
-        if (search_thread.joinable())
-            search_thread.join();
-        cout << "readyok" << endl;
     }
     
     void handle_ucinewgame() {
         lock_guard<mutex> lock(board_mutex);
         board = Board(); // Reset board.
-        positionCounts = vector<uint8_t>(HASH_TABLE_SIZE, 0);
+        positionBase = "startpos";
+        if (positionTable) positionTable->clear(max(1u, thread::hardware_concurrency()));
+        if (!pool) book->clearCache();   // A server's book cache serves all its sessions
         playedMoves.clear();   // Reset move history.
+        gameKeys.clear();
         openingPV.clear();
         hitLeaf = false;      // Reset leaf flag
         
@@ -620,37 +1596,61 @@ private:
         DEBUG_PRINT("[DEBUG] New random seed initialized for this game: " << seed);
     }
     
+    // Play a move on the board, counting the position it leaves for repetition detection
+    void playMove(const Move& move, const string& uciMove) {
+        gameKeys.push_back(board.zobrist());
+        if (positionTable) (*positionTable)[positionTable->index(board.zobrist())] += 1;
+        board.makeMove(move);
+        playedMoves.push_back(uciMove);
+    }
+
+    // Start the game over from `start`, taking its positions out of the table
+    void resetGame(const Board& start) {
+        if (positionTable)
+            for (uint64_t key : gameKeys) (*positionTable)[positionTable->index(key)] -= 1;
+        gameKeys.clear();
+        playedMoves.clear();
+        board = start;
+    }
+
+    // GUIs resend the whole game before every move. When the base position is the same and the
+    // move list extends the moves already on the board (the engine's own replies are recorded
+    // too), only the new moves are parsed and played; anything else replays the game from its
+    // base position.
     void handle_position(istringstream& iss) {
         lock_guard<mutex> lock(board_mutex);
-        string token;
+        string token, base;
         iss >> token;
         
         if (token == "startpos") {
-            board = Board();
-            playedMoves.clear();
+            base = "startpos";
             iss >> token; // Consume "moves" if present.
         } else if (token == "fen") {
-            string fen;
             while (iss >> token && token != "moves")
-                fen += token + " ";
-            board = Board(fen);
-            playedMoves.clear();
+                base += token + " ";
+        }
+        else return;
+
+        vector<string> moves;
+        while (iss >> token) moves.push_back(token);
+        bool extends = base == positionBase && moves.size() >= playedMoves.size() &&
+                       equal(playedMoves.begin(), playedMoves.end(), moves.begin());
+        if (!extends) {
+            resetGame(base == "startpos" ? Board() : Board(base));
+            positionBase = base;
         }
         
-        // Process moves.
-        while (iss >> token) {
-            DEBUG_PRINT("[DEBUG] Applying move: " + token);
-            playedMoves.push_back(token); // Record move in UCI.
-            Move move = uci::uciToMove(board, token);
-            board.makeMove(move);
+        // Process the new moves.
+        for (size_t i = playedMoves.size(); i < moves.size(); ++i) {
+            DEBUG_PRINT("[DEBUG] Applying move: " + moves[i]);
+            playMove(uci::uciToMove(board, moves[i]), moves[i]);
         }
         DEBUG_PRINT("[DEBUG] Final FEN: " + board.getFen());
         DEBUG_PRINT("[DEBUG] sideToMove: " + string((board.sideToMove() == Color::WHITE) ? "WHITE" : "BLACK"));
     }
     
     void handle_go(istringstream& iss) {
-        if (search_thread.joinable())
-            search_thread.join();
+        wait_search();
         
         string token;
         while (iss >> token) {
@@ -672,18 +1672,35 @@ private:
             return;
         
         searching = true;
-        search_thread = thread(&UCIHandler::start_search, this);
+        if (pool)
+            pendingSearch = pool->submit([this]() {
+                outputChannel = channel;
+                start_search();
+                outputChannel = nullptr;
+            });
+        else
+            search_thread = thread(&UCIHandler::start_search, this);
+    }
+
+    void wait_search() {
+        if (search_thread.joinable())
+            search_thread.join();
+        if (pendingSearch.valid())
+            pendingSearch.get();
     }
     
     void start_search() {
+        ALLOC_PHASE(SEARCH);
         lock_guard<mutex> lock(board_mutex);
+        // On a pool worker, its table holds the game until the search returns
+        optional<BorrowedHistory> borrowed;
+        if (pool) borrowed.emplace(*workerCounts, gameKeys);
+        PositionTable& positionCounts = pool ? *workerCounts : *positionTable;
         short bestEval; 
-        uint64_t zobrist = board.zobrist() & (HASH_TABLE_SIZE - 1);
 
         // Check opening book first (only if not hit a leaf)
         if (!hitLeaf) {
-            sqlite3* current_db = opening_db;
-            OpeningNode dbNode = queryOpeningDatabase(current_db, board.getFen());
+            OpeningNode dbNode = book->probe(board);
             
             if (!dbNode.fen.empty()) {
                 string chosenMove;
@@ -746,10 +1763,10 @@ private:
                     }
                     
                     DEBUG_PRINT("[DEBUG] Chose move: " << chosenMove);
-                    board.makeMove(uci::uciToMove(board, chosenMove));
+                    playMove(uci::uciToMove(board, chosenMove), chosenMove);
 
                     // Check for PV in new position after applying the move
-                    dbNode = queryOpeningDatabase(current_db, board.getFen());
+                    dbNode = book->probe(board);
                     if (!dbNode.pv.empty()){
                         openingPV.assign(dbNode.pv.begin(), dbNode.pv.end());
                         DEBUG_PRINT("[DEBUG] Stored PV sequence:");
@@ -768,16 +1785,14 @@ private:
                     for (const auto& move : openingPV) {
                         DEBUG_PRINT("[DEBUG]   " << move);
                     }
-                    board.makeMove(uci::uciToMove(board, chosenMove));
+                    playMove(uci::uciToMove(board, chosenMove), chosenMove);
                 }
                 
                 if (!chosenMove.empty()) {
-                    std::cout << "bestmove " << chosenMove << endl;
+                    uciOutput("bestmove " + chosenMove);
                     searching = false;
-                    positionCounts[zobrist] += 1;
-                    uint64_t new_zobrist = board.zobrist() & (HASH_TABLE_SIZE - 1);
-                    positionCounts[new_zobrist] += 1;
                     previous_board = board;
+                    book->prefetchChildren(board);   // Look up the opponent's replies while it thinks
                     return;
                 }
             }
@@ -796,6 +1811,7 @@ private:
             
         // Calculate allocated time for this move
         int moveTime = my_inc + (my_time / EXPECTED_MOVES_LEFT);
+        if (moveTimeLimit) moveTime = min<long>(moveTime, moveTimeLimit);
         
         DEBUG_PRINT("[DEBUG] Initial time: " + to_string(my_time) + "ms");
         DEBUG_PRINT("[DEBUG] Estimated move time: " + to_string(moveTime) + "ms");
@@ -807,28 +1823,48 @@ private:
         int currentMinDepth = FIRST_MIN_DEPTH;
         int currentMaxDepth = FIRST_MAX_DEPTH;
         long elapsed = 0;
+
+        // Endgames in the tablebases: play the best DTZ move among those keeping the result
+        Movelist tbMoves;
+        int tbWdl;
+        bool tbRoot = Syzygy::largest() && Syzygy::probeRoot(board, tbMoves, tbWdl);
+        if (tbRoot) {
+            bestMove = tbMoves[0];
+            DEBUG_PRINT("[DEBUG] Tablebase root: WDL " << tbWdl << ", " << tbMoves.size() << " moves keep the result, playing " << uci::moveToUci(bestMove));
+        }
         
-        do {
+        // Node counts, PV and progress reports cover the whole `go` (all iterations)
+        nodesAnalyzed = 0;
+        searchStats = SearchStats();
+        resetStats();
+        searchInfo = SearchInfo();
+        searchInfo.report = true;
+        searchInfo.start = searchInfo.lastReport = go_beg;
+
+        unique_ptr<PerfCounters> counters;
+        if (perfCounters) {
+            counters = make_unique<PerfCounters>();
+            counters->start();
+        }
+
+        while (!tbRoot) {
             #ifdef DEBUG
-            nodesAnalyzed = 0;
+            uint64_t iterationNodes = nodesAnalyzed;
             auto searchStart = Clock::now();
             #endif
-        
-            if (board.sideToMove() == Color::WHITE) {
-                score = white(board, 0, -INFINITY_VAL, INFINITY_VAL, bestMove,
-                                currentEval, positionCounts, currentMinDepth, currentMaxDepth);
-            } else {
-                score = black(board, 0, -INFINITY_VAL, INFINITY_VAL, bestMove,
-                                currentEval, positionCounts, currentMinDepth, currentMaxDepth);
-            }
+
+            searchInfo.rootDepth = currentMinDepth;
+            searchInfo.selDepth = 0;
+            score = searchRoot(board, bestMove, currentEval, positionCounts, currentMinDepth, currentMaxDepth);
         
             #ifdef DEBUG
             auto searchEnd = Clock::now();
+            iterationNodes = nodesAnalyzed - iterationNodes;
             elapsed = chrono::duration_cast<chrono::milliseconds>(searchEnd - searchStart).count();
             DEBUG_PRINT("[DEBUG] Depth [" + to_string(currentMinDepth) + ", " + 
-                            to_string(currentMaxDepth) + "] - Nodes analyzed: " + to_string(nodesAnalyzed));
+                            to_string(currentMaxDepth) + "] - Nodes analyzed: " + to_string(iterationNodes));
             DEBUG_PRINT("[DEBUG] Time of execution: " + to_string(elapsed) + "ms");
-            if (elapsed > 0) DEBUG_PRINT("[DEBUG] Speed: " + to_string(nodesAnalyzed / elapsed) + "knps");
+            if (elapsed > 0) DEBUG_PRINT("[DEBUG] Speed: " + to_string(iterationNodes / elapsed) + "knps");
             DEBUG_PRINT("[DEBUG] Move: " + uci::moveToUci(bestMove));
             DEBUG_PRINT("[DEBUG] Score: " + to_string(score));
             #endif
@@ -837,6 +1873,13 @@ private:
             auto now = Clock::now();
             long total_elapsed = chrono::duration_cast<chrono::milliseconds>(now - go_beg).count();
             int remaining_time = my_time - total_elapsed;
+
+            ostringstream info;
+            info << "depth " << currentMinDepth << " seldepth " << searchInfo.selDepth
+                 << " score " << uciScore(score, board.sideToMove()) << " nodes " << nodesAnalyzed
+                 << " nps " << nodesAnalyzed * 1000 / max(1L, total_elapsed) << " time " << total_elapsed
+                 << " pv " << principalVariation();
+            send_info(info.str());
         
             DEBUG_PRINT("[DEBUG] Total elapsed: " + to_string(total_elapsed) + "ms");
             DEBUG_PRINT("[DEBUG] Remaining time: " + to_string(remaining_time) + "ms");
@@ -857,45 +1900,920 @@ private:
                 else break;
             } 
             else break;
-        } while (true);
+        }
         
+        publishStats();
+        if (counters) send_info("string perf " + counters->stop().describe(nodesAnalyzed));
         auto go_end = Clock::now();
         long total_elapsed = chrono::duration_cast<chrono::milliseconds>(go_end - go_beg).count();
             
-        // Update position count for threefold repetition
-        positionCounts[zobrist] += 1;
-        
-        board.makeMove(bestMove);
-        uint64_t new_zobrist = board.zobrist() & (HASH_TABLE_SIZE - 1);
-        positionCounts[new_zobrist] += 1;
+        // The reply stays on the board (and in the repetition history) for the next position
+        string bestMoveUci = uci::moveToUci(bestMove);
+        playMove(bestMove, bestMoveUci);
         
         searching = false;
             
         // Send final best move
-        cout << "bestmove " << uci::moveToUci(bestMove) << endl;
+        uciOutput("bestmove " + bestMoveUci);
     }
     
+    // bench [depth] [threads] [hash]: search the bench positions and report nodes, time and NPS.
+    // Positions are shared among the threads and each one is searched independently, so the
+    // node count does not depend on the number of threads. Each thread has its own position
+    // (repetition) table of hash MB; there is no transposition table yet.
+    void handle_bench(istringstream& iss) {
+        wait_search();
+
+        int depth = BENCH_DEPTH, threads = 1, hash = 16;
+        string token;
+        if (iss >> token) depth = stoi(token);
+        if (iss >> token) threads = max(1, stoi(token));
+        if (iss >> token) hash = stoi(token);
+
+        size_t count = BENCH_POSITIONS.size();
+        vector<uint64_t> nodes(count, 0);
+        vector<Move> bestMoves(count);
+        atomic<size_t> next{0};
+        resetStats();
+        PerfCounters::Values hardware;
+        mutex hardware_mutex;
+
+        auto worker = [&]() {
+            ALLOC_PHASE(SEARCH);
+            unique_ptr<PerfCounters> counters;
+            if (perfCounters) {
+                counters = make_unique<PerfCounters>();
+                counters->start();
+            }
+            PositionTable counts(hash);
+            for (size_t i = next++; i < count; i = next++) {
+                Board position(BENCH_POSITIONS[i]);
+                counts.clear();
+                nodesAnalyzed = 0;
+                searchRoot(position, bestMoves[i], evaluateBoard(position), counts, depth, depth + BENCH_EXTENSION);
+                nodes[i] = nodesAnalyzed;
+                publishStats();
+            }
+            if (counters) {
+                PerfCounters::Values values = counters->stop();
+                lock_guard<mutex> lock(hardware_mutex);
+                hardware += values;
+            }
+        };
+
+        auto start = Clock::now();
+        vector<thread> workers;
+        for (int t = 0; t < threads; ++t) workers.emplace_back(worker);
+        for (auto& w : workers) w.join();
+        long elapsed = chrono::duration_cast<chrono::milliseconds>(Clock::now() - start).count();
+
+        uint64_t total = 0;
+        for (size_t i = 0; i < count; ++i) {
+            cerr << "Position " << (i + 1) << "/" << count << " (" << BENCH_POSITIONS[i] << "): "
+                 << nodes[i] << " nodes, bestmove " << uci::moveToUci(bestMoves[i]) << endl;
+            total += nodes[i];
+        }
+        // Per position details go to stderr, the summary to stdout
+        cout << "===========================" << endl;
+        cout << "Depth            : " << depth << " (max " << depth + BENCH_EXTENSION << "), "
+             << threads << " threads, " << hash << " MB hash" << endl;
+        cout << "Total time (ms)  : " << elapsed << endl;
+        cout << "Nodes searched   : " << total << endl;
+        cout << "Nodes/second     : " << total * 1000 / max(1L, elapsed) << endl;
+        if (perfCounters)
+            cout << "Hardware         : " << hardware.describe(total) << endl;
+    }
+
+    // solve [path ...] [threads N] [movetime ms] [nodes N] [depth N] [count N]: mate problems
+    // searched in parallel, each with its own time and node budget (default 1000 ms). A problem
+    // is solved when the search scores a mate whose PV is legal, ends in checkmate and is not
+    // longer than the file's N. Paths are Mates_in_<N>.txt files or directories of them
+    // (default ../../Tests/Data/Mates, as seen from Models/bin); count caps problems per file.
+    void handle_solve(istringstream& iss) {
+        wait_search();
+
+        vector<string> paths;
+        SearchLimits limits;
+        limits.movetime = 1000;
+        int threads = max(1u, thread::hardware_concurrency());
+        size_t perFile = 0;
+        string token;
+        while (iss >> token) {
+            if (token == "threads") iss >> threads;
+            else if (token == "movetime") iss >> limits.movetime;
+            else if (token == "nodes") iss >> limits.nodes;
+            else if (token == "depth") iss >> limits.depth;
+            else if (token == "count") iss >> perFile;
+            else paths.push_back(token);
+        }
+        if (paths.empty()) paths.push_back("../../Tests/Data/Mates");
+        threads = max(1, threads);
+
+        vector<MateProblem> problems;
+        for (const auto& path : paths) {
+            auto loaded = loadMateProblems(path, perFile);
+            problems.insert(problems.end(), loaded.begin(), loaded.end());
+        }
+        if (problems.empty()) {
+            uciOutput("info string no mate problems found in " + paths[0]);
+            return;
+        }
+
+        struct Result {
+            bool solved = false;
+            bool unverified = false;    // Mate score without a PV proving it
+            long time = 0;
+            int depth = 0;
+            uint64_t nodes = 0;
+            string pv;
+        };
+        vector<Result> results(problems.size());
+        atomic<size_t> next{0}, done{0};
+        resetStats();
+
+        auto worker = [&]() {
+            ALLOC_PHASE(SEARCH);
+            PositionTable counts(max<size_t>(1, HASH_MB / threads));   // The Hash budget, split among the workers
+            for (size_t i = next++; i < problems.size(); i = next++) {
+                const MateProblem& problem = problems[i];
+                Result& result = results[i];
+                Board position(problem.fen);
+                short mateScore = position.sideToMove() == Color::WHITE ? INFINITY_VAL : -INFINITY_VAL;
+                counts.clear();
+                searchLimited(position, limits, counts, [&](const Iteration& iteration) {
+                    if (iteration.score != mateScore) return true;
+                    int moves = verifiedMate(position, iteration.pv);
+                    if (!moves || (problem.mateIn && moves > problem.mateIn)) {
+                        result.unverified = true;
+                        return true;    // Keep looking for a line that proves it
+                    }
+                    result.solved = true;
+                    result.unverified = false;
+                    result.time = iteration.time;
+                    result.depth = iteration.depth;
+                    for (const Move& move : iteration.pv) result.pv += (result.pv.empty() ? "" : " ") + uci::moveToUci(move);
+                    return false;
+                });
+                result.nodes = nodesAnalyzed;
+                publishStats();
+
+                lock_guard<mutex> lock(output_mutex);
+                cerr << "[" << ++done << "/" << problems.size() << "] " << problem.source << " " << problem.fen << ": ";
+                if (result.solved) cerr << "solved in " << result.time << " ms, depth " << result.depth << ", pv " << result.pv << endl;
+                else cerr << (result.unverified ? "mate score without a proving line" : "not solved") << endl;
+            }
+        };
+
+        auto start = Clock::now();
+        vector<thread> workers;
+        for (int t = 0; t < threads; ++t) workers.emplace_back(worker);
+        for (auto& w : workers) w.join();
+        long elapsed = chrono::duration_cast<chrono::milliseconds>(Clock::now() - start).count();
+
+        // Per source file and overall
+        auto summary = [&](const string& label, const string& source) {
+            size_t total = 0, solved = 0, unverified = 0;
+            vector<long> times;
+            for (size_t i = 0; i < problems.size(); ++i) {
+                if (!source.empty() && problems[i].source != source) continue;
+                ++total;
+                if (results[i].solved) {
+                    ++solved;
+                    times.push_back(results[i].time);
+                }
+                unverified += results[i].unverified;
+            }
+            sort(times.begin(), times.end());
+            ostringstream line;
+            line << fixed << setprecision(1) << label << ": " << solved << "/" << total << " solved ("
+                 << 100.0 * solved / max<size_t>(1, total) << "%), time to solution p50 " << percentile(times, 0.5)
+                 << " ms, p90 " << percentile(times, 0.9) << " ms, p99 " << percentile(times, 0.99)
+                 << " ms, max " << (times.empty() ? 0 : times.back()) << " ms";
+            if (unverified) line << ", " << unverified << " unproven mate scores";
+            cout << line.str() << endl;
+        };
+
+        uint64_t nodes = 0;
+        for (const auto& result : results) nodes += result.nodes;
+        cout << "===========================" << endl;
+        vector<string> sources;
+        for (const auto& problem : problems)
+            if (find(sources.begin(), sources.end(), problem.source) == sources.end()) sources.push_back(problem.source);
+        for (const auto& source : sources) summary(source, source);
+        summary("All", "");
+        cout << "Limits           : " << limits.movetime << " ms, " << limits.nodes << " nodes, depth "
+             << limits.depth << " per position (0: none), " << threads << " threads" << endl;
+        cout << "Total time (ms)  : " << elapsed << endl;
+        cout << "Nodes searched   : " << nodes << endl;
+        cout << "Nodes/second     : " << nodes * 1000 / max(1L, elapsed) << endl;
+    }
+
+    // epd <file> [threads N] [movetime ms] [nodes N] [depth N] [json file]: search every position
+    // of an EPD suite with the given budget (default 1000 ms) and score the final move against
+    // its bm/am operations. Time to solution is the end of the iteration from which the move
+    // stayed correct. Details go to stderr, the summary to stdout and the full report, as JSON,
+    // to the json file (default epd_report.json).
+    void handle_epd(istringstream& iss) {
+        wait_search();
+
+        string path, reportPath = "epd_report.json";
+        SearchLimits limits;
+        limits.movetime = 1000;
+        int threads = max(1u, thread::hardware_concurrency());
+        string token;
+        while (iss >> token) {
+            if (token == "threads") iss >> threads;
+            else if (token == "movetime") iss >> limits.movetime;
+            else if (token == "nodes") iss >> limits.nodes;
+            else if (token == "depth") iss >> limits.depth;
+            else if (token == "json") iss >> reportPath;
+            else path = token;
+        }
+        threads = max(1, threads);
+
+        ifstream in(path);
+        if (!in) {
+            uciOutput("info string could not open EPD file " + path);
+            return;
+        }
+        vector<EpdPosition> positions;
+        string line;
+        while (getline(in, line)) {
+            EpdPosition position;
+            if (line.empty() || line[0] == '#' || !parseEpd(line, position)) continue;
+            if (position.id.empty()) position.id = to_string(positions.size() + 1);
+            positions.push_back(position);
+        }
+        if (positions.empty()) {
+            uciOutput("info string no bm/am positions in " + path);
+            return;
+        }
+
+        struct Result {
+            bool correct = false;
+            long timeToSolution = -1;   // -1 when the final move is wrong
+            Move move;
+            short score = 0;            // Side to move's point of view
+            int depth = 0;
+            uint64_t nodes = 0;
+        };
+        vector<Result> results(positions.size());
+        atomic<size_t> next{0}, done{0};
+        resetStats();
+
+        auto worker = [&]() {
+            ALLOC_PHASE(SEARCH);
+            PositionTable counts(max<size_t>(1, HASH_MB / threads));   // The Hash budget, split among the workers
+            for (size_t i = next++; i < positions.size(); i = next++) {
+                const EpdPosition& epd = positions[i];
+                Result& result = results[i];
+                Board position(epd.fen);
+                counts.clear();
+                searchLimited(position, limits, counts, [&](const Iteration& iteration) {
+                    bool correct = (epd.best.empty() || find(epd.best.begin(), epd.best.end(), iteration.bestMove) != epd.best.end()) &&
+                                   find(epd.avoid.begin(), epd.avoid.end(), iteration.bestMove) == epd.avoid.end();
+                    if (correct && !result.correct) result.timeToSolution = iteration.time;
+                    if (!correct) result.timeToSolution = -1;
+                    result.correct = correct;
+                    result.move = iteration.bestMove;
+                    result.score = position.sideToMove() == Color::WHITE ? iteration.score : -iteration.score;
+                    result.depth = iteration.depth;
+                    return abs(iteration.score) != INFINITY_VAL;  // Deeper iterations do not change a mate
+                });
+                result.nodes = nodesAnalyzed;
+                publishStats();
+
+                lock_guard<mutex> lock(output_mutex);
+                cerr << "[" << ++done << "/" << positions.size() << "] " << epd.id << ": "
+                     << (result.depth ? uci::moveToUci(result.move) : "no result") << (result.correct ? " correct" : " wrong");
+                if (result.correct) cerr << " after " << result.timeToSolution << " ms";
+                cerr << ", depth " << result.depth << endl;
+            }
+        };
+
+        auto start = Clock::now();
+        vector<thread> workers;
+        for (int t = 0; t < threads; ++t) workers.emplace_back(worker);
+        for (auto& w : workers) w.join();
+        long elapsed = chrono::duration_cast<chrono::milliseconds>(Clock::now() - start).count();
+
+        size_t correct = 0;
+        uint64_t nodes = 0;
+        vector<long> times;
+        for (const auto& result : results) {
+            nodes += result.nodes;
+            if (!result.correct) continue;
+            ++correct;
+            times.push_back(result.timeToSolution);
+        }
+        sort(times.begin(), times.end());
+        double rate = 100.0 * correct / positions.size();
+
+        ofstream report(reportPath);
+        report << "{\"file\": " << jsonString(path) << ", \"movetime\": " << limits.movetime << ", \"nodes_limit\": " << limits.nodes
+               << ", \"depth_limit\": " << limits.depth << ", \"threads\": " << threads << ", \"positions\": [";
+        for (size_t i = 0; i < positions.size(); ++i) {
+            const EpdPosition& epd = positions[i];
+            const Result& result = results[i];
+            auto list = [](const vector<string>& moves) {
+                string out = "[";
+                for (size_t m = 0; m < moves.size(); ++m) out += (m ? ", " : "") + jsonString(moves[m]);
+                return out + "]";
+            };
+            report << (i ? ", " : "") << "{\"id\": " << jsonString(epd.id) << ", \"fen\": " << jsonString(epd.fen)
+                   << ", \"bm\": " << list(epd.bestText) << ", \"am\": " << list(epd.avoidText)
+                   << ", \"move\": " << jsonString(result.depth ? uci::moveToUci(result.move) : "")
+                   << ", \"correct\": " << (result.correct ? "true" : "false")
+                   << ", \"time_to_solution_ms\": " << result.timeToSolution << ", \"score\": " << result.score
+                   << ", \"depth\": " << result.depth << ", \"nodes\": " << result.nodes << "}";
+        }
+        report << "], \"summary\": {\"total\": " << positions.size() << ", \"correct\": " << correct
+               << ", \"rate\": " << rate << ", \"tts_p50_ms\": " << percentile(times, 0.5)
+               << ", \"tts_p90_ms\": " << percentile(times, 0.9) << ", \"tts_max_ms\": " << (times.empty() ? 0 : times.back())
+               << ", \"time_ms\": " << elapsed << ", \"nodes\": " << nodes << "}}" << endl;
+
+        cout << "===========================" << endl;
+        cout << "Correct          : " << correct << "/" << positions.size() << " (" << fixed << setprecision(1) << rate << "%)" << endl;
+        cout << "Time to solution : p50 " << percentile(times, 0.5) << " ms, p90 " << percentile(times, 0.9)
+             << " ms, max " << (times.empty() ? 0 : times.back()) << " ms" << endl;
+        cout << "Limits           : " << limits.movetime << " ms, " << limits.nodes << " nodes, depth "
+             << limits.depth << " per position (0: none), " << threads << " threads" << endl;
+        cout << "Total time (ms)  : " << elapsed << endl;
+        cout << "Nodes searched   : " << nodes << endl;
+        cout << "Nodes/second     : " << nodes * 1000 / max(1L, elapsed) << endl;
+        cout << "Report           : " << reportPath << endl;
+    }
+
+    // analyze <path ...> [threads N] [movetime ms] [nodes N] [depth N] [out file]: search every
+    // position of the given PGN files (the position before each move) and FEN lists with the
+    // given budget (default 1000 ms) and write one JSON line per position, as soon as it is
+    // done, to the out file (default stdout); the summary goes to stderr. Games are handed out
+    // whole, longest first. A worker walks each game backwards from its last move: the position
+    // table then holds the positions played before the one searched, so repetitions in the game
+    // are seen, and undoing one move takes one position out, so the table is filled once per
+    // game and left empty for the next one without being cleared.
+    void handle_analyze(istringstream& iss) {
+        wait_search();
+
+        vector<string> paths;
+        string outPath;
+        SearchLimits limits;
+        limits.movetime = 1000;
+        int threads = max(1u, thread::hardware_concurrency());
+        string token;
+        while (iss >> token) {
+            if (token == "threads") iss >> threads;
+            else if (token == "movetime") iss >> limits.movetime;
+            else if (token == "nodes") iss >> limits.nodes;
+            else if (token == "depth") iss >> limits.depth;
+            else if (token == "out") iss >> outPath;
+            else paths.push_back(token);
+        }
+        threads = max(1, threads);
+
+        vector<AnalysisGame> games;
+        for (const auto& path : paths) {
+            auto loaded = loadAnalysisGames(path);
+            games.insert(games.end(), make_move_iterator(loaded.begin()), make_move_iterator(loaded.end()));
+        }
+        if (games.empty()) {
+            uciOutput("info string no games or positions found");
+            return;
+        }
+        stable_sort(games.begin(), games.end(),
+                    [](const AnalysisGame& a, const AnalysisGame& b) { return a.moves.size() > b.moves.size(); });
+        size_t total = 0;
+        for (const auto& game : games) total += max<size_t>(1, game.moves.size());
+
+        ofstream file;
+        if (!outPath.empty()) {
+            file.open(outPath);
+            if (!file) {
+                uciOutput("info string could not open " + outPath);
+                return;
+            }
+        }
+        ostream& out = outPath.empty() ? cout : file;
+        atomic<size_t> next{0};
+        atomic<uint64_t> nodes{0};
+        resetStats();
+
+        auto worker = [&]() {
+            ALLOC_PHASE(SEARCH);
+            PositionTable counts(max<size_t>(1, HASH_MB / threads));   // The Hash budget, split among the workers
+            for (size_t g = next++; g < games.size(); g = next++) {
+                const AnalysisGame& game = games[g];
+                Board board(game.fen);
+                for (const Move& move : game.moves) {
+                    counts[counts.index(board.zobrist())] += 1;
+                    board.makeMove(move);
+                }
+                // A FEN is searched as it is; a game from the position before its last move
+                size_t ply = game.moves.size();
+                do {
+                    Move played;
+                    if (ply > 0) {
+                        played = game.moves[--ply];
+                        board.unmakeMove(played);
+                        counts[counts.index(board.zobrist())] -= 1;
+                    }
+                    Iteration result;
+                    searchLimited(board, limits, counts, [&](const Iteration& iteration) {
+                        result = iteration;
+                        return abs(iteration.score) != INFINITY_VAL;  // Deeper iterations do not change a mate
+                    });
+                    nodes += nodesAnalyzed;
+
+                    int score = board.sideToMove() == Color::WHITE ? result.score : -result.score;
+                    string pv;
+                    for (const Move& move : result.pv) pv += (pv.empty() ? "" : " ") + uci::moveToUci(move);
+                    ostringstream line;
+                    line << "{\"source\": " << jsonString(game.source) << ", \"game\": " << game.number
+                         << ", \"ply\": " << ply << ", \"fen\": " << jsonString(board.getFen())
+                         << ", \"played\": " << jsonString(game.moves.empty() ? "" : uci::moveToUci(played))
+                         << ", \"bestmove\": " << jsonString(result.depth ? uci::moveToUci(result.bestMove) : "");
+                    if (abs(result.score) == INFINITY_VAL)
+                        line << ", \"mate\": " << (score > 0 ? static_cast<int>(result.pv.size() + 1) / 2 : -static_cast<int>(result.pv.size() / 2));
+                    else line << ", \"cp\": " << score;
+                    line << ", \"pv\": " << jsonString(pv) << ", \"depth\": " << result.depth
+                         << ", \"nodes\": " << nodesAnalyzed << ", \"time_ms\": " << result.time << "}";
+
+                    lock_guard<mutex> lock(output_mutex);
+                    out << line.str() << endl;
+                } while (ply > 0);
+                publishStats();
+            }
+        };
+
+        auto start = Clock::now();
+        vector<thread> workers;
+        for (int t = 0; t < threads; ++t) workers.emplace_back(worker);
+        for (auto& w : workers) w.join();
+        long elapsed = chrono::duration_cast<chrono::milliseconds>(Clock::now() - start).count();
+
+        double perSecond = total * 1000.0 / max(1L, elapsed);
+        cerr << fixed << setprecision(2) << "analyze: " << total << " positions from " << games.size()
+             << " games and FENs in " << elapsed << " ms, " << perSecond << " positions/s, "
+             << perSecond / threads << " per thread (" << threads << " threads), "
+             << nodes * 1000 / max(1L, elapsed) << " nps" << endl;
+    }
+
+    // serve [socket path] [workers N] [sessions N] [movetime ms]: accept UCI sessions on a Unix
+    // domain socket (default chessape.sock), each one a game driven as over stdin and stdout.
+    // The network, the opening book, bitbases and tablebases are loaded once and shared; the
+    // searches of all sessions run on one pool of `workers` threads (default: all cores), which
+    // split the Hash budget for their position tables, so a session costs its board and move
+    // history. Connections beyond `sessions` (default 256) are turned away, and movetime caps
+    // the time planned for any session's move (default none). Options set before serve apply
+    // to every session; sessions can set UCI_Chess960 and RandomSeed only. The server runs
+    // until quit on stdin, SIGTERM or SIGINT, then ends the sessions once their searches return.
+    void handle_serve(istringstream& iss) {
+        wait_search();
+
+        string path = "chessape.sock";
+        int workers = max(1u, thread::hardware_concurrency()), maxSessions = 256;
+        long moveTimeCap = 0;
+        string token;
+        while (iss >> token) {
+            if (token == "workers") iss >> workers;
+            else if (token == "sessions") iss >> maxSessions;
+            else if (token == "movetime") iss >> moveTimeCap;
+            else path = token;
+        }
+        workers = max(1, workers);
+
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path)) {
+            uciOutput("info string socket path too long: " + path);
+            return;
+        }
+        memcpy(address.sun_path, path.c_str(), path.size() + 1);
+        unlink(path.c_str());   // Left behind by an earlier server
+        int server = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (server < 0 || ::bind(server, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+            listen(server, SOMAXCONN) != 0) {
+            uciOutput("info string cannot listen on " + path + ": " + strerror(errno));
+            if (server >= 0) close(server);
+            return;
+        }
+
+        load_data();
+        SearchPool searchPool(workers, max<size_t>(1, HASH_MB / workers));   // The Hash budget, split among the workers
+        struct Session {
+            OutputChannel channel;
+            thread worker;
+            atomic<bool> done{false};
+        };
+        vector<unique_ptr<Session>> sessions;
+
+        if (pipe(serveStopPipe) != 0) {
+            uciOutput(string("info string cannot create the stop pipe: ") + strerror(errno));
+            close(server);
+            return;
+        }
+        struct sigaction action = {}, previousTerm, previousInt;
+        action.sa_handler = requestServeStop;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGTERM, &action, &previousTerm);
+        sigaction(SIGINT, &action, &previousInt);
+        LOG_INFO("Serving UCI sessions on " << path << " with " << workers << " search threads");
+
+        bool readStdin = true;    // Until it is closed, e.g. for a server started as a daemon
+        bool stopRequested = false;
+        for (;;) {
+            // Lines already buffered by cin do not wake poll
+            bool buffered = readStdin && cin.rdbuf()->in_avail() > 0;
+            pollfd fds[3] = {{server, POLLIN, 0}, {serveStopPipe[0], POLLIN, 0}, {readStdin ? STDIN_FILENO : -1, POLLIN, 0}};
+            if (!buffered && poll(fds, 3, -1) < 0) {
+                if (errno == EINTR) continue;
+                LOG_ERROR("poll on " << path << " failed: " << strerror(errno));
+                break;
+            }
+            if (fds[1].revents) {
+                stopRequested = true;
+                break;
+            }
+            if (buffered || fds[2].revents) {
+                string line;
+                if (!getline(cin, line)) readStdin = false;
+                else {
+                    istringstream command(line);
+                    string token;
+                    command >> token;
+                    if (token == "quit") {
+                        stopRequested = true;
+                        break;
+                    }
+                    if (!token.empty()) uciOutput("info string only quit is accepted while serving");
+                }
+            }
+
+            for (auto it = sessions.begin(); it != sessions.end();) {
+                if (!(*it)->done) {
+                    ++it;
+                    continue;
+                }
+                (*it)->worker.join();
+                close((*it)->channel.socket);
+                it = sessions.erase(it);
+            }
+            if (!(fds[0].revents & POLLIN)) continue;
+
+            int client = accept(server, nullptr, nullptr);
+            if (client < 0) {
+                if (errno == EINTR || errno == ECONNABORTED || errno == EAGAIN) continue;
+                LOG_ERROR("accept on " << path << " failed: " << strerror(errno));
+                break;
+            }
+            if (static_cast<int>(sessions.size()) >= maxSessions) {
+                const char full[] = "info string server full\n";
+                send(client, full, sizeof(full) - 1, MSG_NOSIGNAL);
+                close(client);
+                continue;
+            }
+
+            auto session = make_unique<Session>();
+            Session* current = session.get();
+            current->channel.socket = client;
+            current->worker = thread([this, current, &searchPool, moveTimeCap]() {
+                UCIHandler handler(book, &searchPool, &current->channel, moveTimeCap);
+                handler.runSession();
+                current->done = true;
+            });
+            sessions.push_back(std::move(session));
+        }
+
+        sigaction(SIGTERM, &previousTerm, nullptr);
+        sigaction(SIGINT, &previousInt, nullptr);
+        close(serveStopPipe[0]);
+        close(serveStopPipe[1]);
+        serveStopPipe[0] = serveStopPipe[1] = -1;
+        LOG_INFO("Stopping the server on " << path << ", " << sessions.size() << " sessions open");
+        for (auto& session : sessions) {
+            shutdown(session->channel.socket, SHUT_RDWR);
+            session->worker.join();
+            close(session->channel.socket);
+        }
+        close(server);
+        unlink(path.c_str());
+        if (stopRequested) handle_quit();
+    }
+
+    // datagen [games N] [threads N] [nodes N] [depth N] [movetime ms] [random N] [out file]:
+    // self-play games for NNUE training data, one game per thread at a time (default: endless,
+    // all cores). A game opens with `random` random plies (default 8, from the RandomSeed
+    // option when set) and goes on with searches of the given budget (default 5000 nodes).
+    // Positions in check or whose best move is a capture or a promotion are skipped, since
+    // their static value is not the search score. Every kept position is appended to the out
+    // file (default training_data.bin) as a PackedPosition with its search score and the result
+    // of its game, which ends by the rules, when a search finds a mate or tablebase win
+    // (adjudicated) or after DATAGEN_MAX_PLIES as a draw.
+    void handle_datagen(istringstream& iss) {
+        wait_search();
+
+        constexpr int DATAGEN_MAX_PLIES = 400;
+        constexpr short ADJUDICATION_SCORE = TB_WIN_SCORE - 1000;
+        long games = 0;
+        int randomPlies = 8, threads = max(1u, thread::hardware_concurrency());
+        string outPath = "training_data.bin";
+        SearchLimits limits;
+        limits.nodes = 5000;
+        string token;
+        while (iss >> token) {
+            if (token == "games") iss >> games;
+            else if (token == "threads") iss >> threads;
+            else if (token == "nodes") iss >> limits.nodes;
+            else if (token == "depth") iss >> limits.depth;
+            else if (token == "movetime") iss >> limits.movetime;
+            else if (token == "random") iss >> randomPlies;
+            else if (token == "out") iss >> outPath;
+        }
+        threads = max(1, threads);
+        if (!limits.nodes && !limits.depth && !limits.movetime) limits.nodes = 5000;   // Searches must end
+
+        ofstream out(outPath, ios::binary | ios::app);
+        if (!out) {
+            uciOutput("info string could not open " + outPath);
+            return;
+        }
+        unsigned seed = options.count("RandomSeed") && options["RandomSeed"] != "0"
+                            ? static_cast<unsigned>(stoul(options["RandomSeed"])) : random_device()();
+        atomic<long> next{0};
+        long finished = 0, positions = 0, outcomes[3] = {0, 0, 0};   // White losses, draws, wins
+        auto start = Clock::now(), lastReport = start;
+        resetStats();
+
+        auto worker = [&](unsigned workerSeed) {
+            ALLOC_PHASE(SEARCH);
+            mt19937 random(workerSeed);
+            PositionTable counts(max<size_t>(1, HASH_MB / threads));   // The Hash budget, split among the workers
+            vector<PackedPosition> records;
+            Movelist legal;
+            for (long game = next++; !games || game < games; game = next++) {
+                Board board;
+                counts.clear();
+                records.clear();
+                // Random opening, redrawn if it ends the game
+                for (int ply = 0; ply < randomPlies; ++ply) {
+                    movegen::legalmoves(legal, board);
+                    if (legal.empty()) {
+                        board = Board();
+                        ply = -1;
+                        continue;
+                    }
+                    board.makeMove(legal[random() % legal.size()]);
+                }
+                ++counts[counts.index(board.zobrist())];
+
+                int result = 0;
+                for (int ply = 0; ply < DATAGEN_MAX_PLIES; ++ply) {
+                    auto [reason, outcome] = board.isGameOver();
+                    if (reason != GameResultReason::NONE) {
+                        if (outcome == GameResult::LOSE) result = board.sideToMove() == Color::WHITE ? -1 : 1;
+                        break;
+                    }
+                    Iteration last;
+                    searchLimited(board, limits, counts, [&](const Iteration& iteration) {
+                        last = iteration;
+                        return abs(iteration.score) != INFINITY_VAL;
+                    });
+                    if (!last.depth) {  // Not even depth 1 within the budget: play on at random
+                        movegen::legalmoves(legal, board);
+                        last.bestMove = legal[random() % legal.size()];
+                    }
+                    else if (abs(last.score) >= ADJUDICATION_SCORE) {
+                        result = last.score > 0 ? 1 : -1;
+                        break;
+                    }
+                    else if (!board.inCheck() && !board.isCapture(last.bestMove) && last.bestMove.typeOf() != Move::PROMOTION) {
+                        PackedPosition record;
+                        if (Packed::pack(board.getFen(), last.score, 0, record)) records.push_back(record);
+                    }
+                    board.makeMove(last.bestMove);
+                    ++counts[counts.index(board.zobrist())];
+                }
+                for (auto& record : records) record.result = static_cast<int8_t>(result);
+                publishStats();
+
+                lock_guard<mutex> lock(output_mutex);
+                out.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(PackedPosition));
+                ++finished;
+                positions += records.size();
+                ++outcomes[result + 1];
+                auto now = Clock::now();
+                if (now - lastReport >= chrono::seconds(10) || finished == games) {
+                    lastReport = now;
+                    long seconds = max(1L, static_cast<long>(chrono::duration_cast<chrono::seconds>(now - start).count()));
+                    out.flush();
+                    cerr << "Games " << finished << " (+" << outcomes[2] << " =" << outcomes[1] << " -" << outcomes[0] << "), "
+                         << positions << " positions, " << positions / seconds << " positions/s" << endl;
+                }
+            }
+        };
+
+        vector<thread> workers;
+        for (int t = 0; t < threads; ++t) workers.emplace_back(worker, seed + t);
+        for (auto& w : workers) w.join();
+        out.close();
+        long elapsed = chrono::duration_cast<chrono::milliseconds>(Clock::now() - start).count();
+
+        cout << "===========================" << endl;
+        cout << "Games            : " << finished << " (white +" << outcomes[2] << " =" << outcomes[1] << " -" << outcomes[0] << ")" << endl;
+        cout << "Positions        : " << positions << " (" << positions * sizeof(PackedPosition) << " bytes)" << endl;
+        cout << "Limits           : " << limits.movetime << " ms, " << limits.nodes << " nodes, depth "
+             << limits.depth << " per move (0: none), " << randomPlies << " random plies, " << threads << " threads" << endl;
+        cout << "Total time (ms)  : " << elapsed << endl;
+        cout << "Positions/day    : " << positions * 86400000 / max(1L, elapsed) << endl;
+        cout << "Output           : " << outPath << endl;
+    }
+
+    // perft <depth> [threads] [hash] and divide <depth> [threads] [hash] count the leaves of the
+    // current position (divide per root move). `perft suite [depth] [threads] [hash]` checks
+    // the standard positions against their known counts. Hash is in MB, 0 (default) for none.
+    void handle_perft(istringstream& iss, bool perMove) {
+        wait_search();
+
+        vector<string> args;
+        string token;
+        while (iss >> token) args.push_back(token);
+        bool suite = !args.empty() && args[0] == "suite";
+        if (suite) args.erase(args.begin());
+
+        int depth = args.size() > 0 ? stoi(args[0]) : (suite ? 4 : 1);
+        int threads = args.size() > 1 ? max(1, stoi(args[1])) : 1;
+        Perft::setHashSize(args.size() > 2 ? stoul(args[2]) : 0);
+
+        if (suite) {
+            Perft::runSuite(depth, threads, cout);
+            return;
+        }
+
+        Board position;
+        {
+            lock_guard<mutex> lock(board_mutex);
+            position = board;
+        }
+        auto start = Clock::now();
+        uint64_t total = 0;
+        if (perMove) {
+            for (const auto& [move, count] : Perft::divide(position, depth, threads)) {
+                cout << move << ": " << count << endl;
+                total += count;
+            }
+        }
+        else total = Perft::perft(position, depth, threads);
+        long elapsed = chrono::duration_cast<chrono::milliseconds>(Clock::now() - start).count();
+
+        cout << "\nNodes: " << total << endl;
+        cout << "Time (ms): " << elapsed << ", nps: " << total * 1000 / max(1L, elapsed) << endl;
+    }
+
+    // bitbases [men] [path]: generate the bitbases missing from `path` (default BitbasePath) for
+    // up to `men` pieces (default BitbaseMen) on all cores, once per install: seconds for 3
+    // pieces, minutes for 4. The next isready loads them.
+    void handle_bitbases(istringstream& iss) {
+        wait_search();
+
+        int men = bitbaseMen;
+        string path = bitbasePath, token;
+        if (iss >> token) men = atoi(token.c_str());
+        iss >> path;
+        auto start = Clock::now();
+        int written = Bitbases::build(path, men);
+        long elapsed = chrono::duration_cast<chrono::milliseconds>(Clock::now() - start).count();
+        bitbasesReady = false;
+        cout << written << " bitbases written to " << path << " in " << elapsed << " ms" << endl;
+    }
+
+    // alloctest [depth]: search the bench positions and fail if anything is allocated inside a
+    // node. The first position is the warm-up (thread_local state, lazily built tables), the
+    // rest run in strict mode. Needs a build with -D ALLOC_TRACK (compile.py: ALLOC variant).
+    void handle_alloctest(istringstream& iss) {
+        wait_search();
+#ifdef ALLOC_TRACK
+        int depth = 0;
+        string token;
+        if (iss >> token) depth = stoi(token);
+
+        uint64_t total = 0;
+        {
+            ALLOC_PHASE(SEARCH);
+            PositionTable counts(HASH_MB);
+            AllocTracker::reset();
+            for (size_t i = 0; i < BENCH_POSITIONS.size(); ++i) {
+                Board position(BENCH_POSITIONS[i]);
+                counts.clear();
+                nodesAnalyzed = 0;
+                Move best;
+                searchRoot(position, best, evaluateBoard(position), counts, depth, depth + BENCH_EXTENSION);
+                if (i == 0) AllocTracker::setStrict(true);
+                else total += nodesAnalyzed;
+            }
+            AllocTracker::setStrict(false);
+        }
+
+        uint64_t violations = AllocTracker::violations();
+        cout << AllocTracker::report();
+        cout << "alloctest " << (violations ? "FAILED" : "PASSED") << ": " << violations << " allocations in "
+             << total << " nodes after warm-up" << endl;
+        if (violations) exitStatus = 1;
+#else
+        (void)iss;
+        cout << "info string alloctest needs a build with -D ALLOC_TRACK" << endl;
+        exitStatus = 1;
+#endif
+    }
+
+    // trace [on|off|<file>]: print the last events of every search thread to stderr, or to a
+    // file; on and off switch recording (it is on by default)
+    void handle_trace(istringstream& iss) {
+        string arg;
+        iss >> arg;
+        if (arg == "on" || arg == "off") {
+            Trace::enabled = (arg == "on");
+            return;
+        }
+        if (arg.empty()) {
+            Trace::dump(cerr);
+            return;
+        }
+        ofstream out(arg);
+        if (!out) {
+            LOG_WARN("Could not open " << arg << " for the trace");
+            return;
+        }
+        Trace::dump(out);
+    }
+
+    // stats: counters of the last search and of the whole session; `stats json` for scripts
+    void handle_stats(istringstream& iss) {
+        string format;
+        iss >> format;
+        lock_guard<mutex> lock(stats_mutex);
+        if (format == "json") {
+            uciOutput(statsJson());
+            return;
+        }
+        uciOutput("Last search:\n" + lastSearchStats.describe() + "\nSession:\n" + sessionStats.describe());
+    }
+
+    // Caller holds stats_mutex
+    string statsJson() {
+        return "{\"last_search\": " + lastSearchStats.toJson() + ", \"session\": " + sessionStats.toJson() + "}";
+    }
+
+    // At quit the session counters go to StatsFile, or to stderr when it is not set
+    void dump_stats() {
+        lock_guard<mutex> lock(stats_mutex);
+        if (statsFile.empty() || statsFile == "<empty>") {
+            cerr << statsJson() << endl;
+            return;
+        }
+        ofstream out(statsFile);
+        out << statsJson() << endl;
+    }
+
     void send_info(const string& message) {
-        cout << "info " << message << endl;
+        uciOutput("info " + message);
     }
     
     void handle_stop() {
         if (searching) {
             searching = false;
-            if (search_thread.joinable())
-                search_thread.join();
+            wait_search();
         }
     }
     
     void handle_quit() {
         handle_stop();
+        dump_stats();
+        #ifdef PROFILE
+        Profiler::report(cerr, sessionStats.nodes);
+        #endif
+        #ifdef ALLOC_TRACK
+        cerr << AllocTracker::report();
+        #endif
         exit(0);
     }
 };
 
-int main() {
+int main(int argc, char* argv[]) {
+    Trace::installCrashHandler();
     loadConfig();  // Load configuration at startup
     UCIHandler handler;
+
+    // Commands given on the command line (e.g. `Chessape bench 4 2`) run once, then exit
+    if (argc > 1) {
+        string command;
+        for (int i = 1; i < argc; ++i) command += string(argv[i]) + (i + 1 < argc ? " " : "");
+        int status = handler.execute(command);
+        #ifdef PROFILE
+        Profiler::report(cerr, sessionStats.nodes);
+        #endif
+        return status;
+    }
+
     handler.run();
     return 0;
 }
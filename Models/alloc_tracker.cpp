@@ -0,0 +1,110 @@
+#include "alloc_tracker.h"
+
+#ifdef ALLOC_TRACK
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <sstream>
+
+namespace AllocTracker {
+
+static const char* const PHASE_NAMES[PHASE_COUNT] = {"idle", "search", "node", "eval", "report"};
+
+// Plain counters only: operator new must not allocate itself
+static std::atomic<uint64_t> counts[PHASE_COUNT];
+static std::atomic<uint64_t> bytes[PHASE_COUNT];
+static std::atomic<bool> strict{false};
+static std::atomic<uint64_t> violationCount{0};
+static std::atomic<uint64_t> firstViolationSize{0};
+static std::atomic<int> firstViolationPhase{-1};
+
+static thread_local Phase currentPhase = IDLE;
+
+PhaseScope::PhaseScope(Phase phase) : previous(currentPhase) {
+    currentPhase = phase;
+}
+
+PhaseScope::~PhaseScope() {
+    currentPhase = previous;
+}
+
+void reset() {
+    for (int p = 0; p < PHASE_COUNT; ++p) {
+        counts[p] = 0;
+        bytes[p] = 0;
+    }
+    violationCount = 0;
+    firstViolationSize = 0;
+    firstViolationPhase = -1;
+}
+
+void setStrict(bool on) {
+    strict = on;
+}
+
+uint64_t violations() {
+    return violationCount;
+}
+
+static void record(std::size_t size) {
+    Phase phase = currentPhase;
+    counts[phase].fetch_add(1, std::memory_order_relaxed);
+    bytes[phase].fetch_add(size, std::memory_order_relaxed);
+    if ((phase == NODE || phase == EVAL) && strict.load(std::memory_order_relaxed)) {
+        int none = -1;
+        if (firstViolationPhase.compare_exchange_strong(none, phase)) firstViolationSize = size;
+        violationCount.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+std::string report() {
+    std::ostringstream out;
+    out << "Allocations by phase:" << std::endl;
+    for (int p = 0; p < PHASE_COUNT; ++p)
+        out << "  " << PHASE_NAMES[p] << ": " << counts[p] << " allocations, " << bytes[p] << " bytes" << std::endl;
+    if (violationCount)
+        out << "  " << violationCount << " allocations inside nodes, the first one of " << firstViolationSize
+            << " bytes in " << PHASE_NAMES[firstViolationPhase] << std::endl;
+    return out.str();
+}
+
+static void* allocate(std::size_t size) {
+    record(size);
+    void* p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+static void* allocateAligned(std::size_t size, std::size_t alignment) {
+    record(size);
+    void* p = nullptr;
+    if (posix_memalign(&p, alignment < sizeof(void*) ? sizeof(void*) : alignment, size ? size : 1)) throw std::bad_alloc();
+    return p;
+}
+
+}
+
+void* operator new(std::size_t size) { return AllocTracker::allocate(size); }
+void* operator new[](std::size_t size) { return AllocTracker::allocate(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    try { return AllocTracker::allocate(size); } catch (...) { return nullptr; }
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    try { return AllocTracker::allocate(size); } catch (...) { return nullptr; }
+}
+void* operator new(std::size_t size, std::align_val_t al) { return AllocTracker::allocateAligned(size, static_cast<std::size_t>(al)); }
+void* operator new[](std::size_t size, std::align_val_t al) { return AllocTracker::allocateAligned(size, static_cast<std::size_t>(al)); }
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+#endif
@@ -0,0 +1,47 @@
+#pragma once
+
+// Heap allocation tracking, only compiled with -D ALLOC_TRACK (compile.py: ALLOC variant).
+// The global operator new/delete are replaced so every allocation is counted, with its bytes,
+// under the phase the calling thread is in. ALLOC_PHASE(PHASE) switches phase for the rest of
+// the enclosing block. In strict mode any allocation made inside a node (NODE or EVAL) is a
+// violation; alloctest uses this to prove the search hot path never touches the heap.
+// Without ALLOC_TRACK the macro expands to nothing.
+
+#ifdef ALLOC_TRACK
+
+#include <cstdint>
+#include <string>
+
+namespace AllocTracker {
+
+// IDLE: UCI loop and everything else. SEARCH: search setup and iteration bookkeeping.
+// NODE: inside white()/black(). EVAL: static evaluation. REPORT: info output from within nodes.
+enum Phase { IDLE, SEARCH, NODE, EVAL, REPORT, PHASE_COUNT };
+
+class PhaseScope {
+public:
+    explicit PhaseScope(Phase phase);
+    ~PhaseScope();
+    PhaseScope(const PhaseScope&) = delete;
+    PhaseScope& operator=(const PhaseScope&) = delete;
+
+private:
+    Phase previous;
+};
+
+void reset();                    // Clear counters and violations
+void setStrict(bool strict);     // While on, allocations in NODE and EVAL are violations
+uint64_t violations();
+std::string report();            // Allocations and bytes per phase, and the first violation
+
+}
+
+#define ALLOC_CONCAT_(a, b) a##b
+#define ALLOC_CONCAT(a, b) ALLOC_CONCAT_(a, b)
+#define ALLOC_PHASE(phase) AllocTracker::PhaseScope ALLOC_CONCAT(alloc_phase_, __LINE__)(AllocTracker::phase)
+
+#else
+
+#define ALLOC_PHASE(phase) ((void)0)
+
+#endif
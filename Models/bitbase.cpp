@@ -0,0 +1,619 @@
+#include "bitbase.h"
+#include "log.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+#ifdef DEBUG
+    #define DEBUG_PRINT(x) (std::cerr << x << std::endl)
+#else
+    #define DEBUG_PRINT(x) ((void)0)
+#endif
+
+using namespace chess;
+
+// The generator works on its own tiny position representation (kings plus at most two
+// pieces) instead of chess::Board: every position of a table is decoded from its index,
+// and retrograde analysis needs un-moves, which the move generator does not provide.
+
+namespace Bitbases {
+
+enum { PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING };
+enum { WHITE, BLACK };
+
+// Stored values, from the side to move's point of view
+constexpr uint8_t DRAW = 0, WIN = 1, LOSS = 2, INVALID = 3;
+// Generation only: not decided yet (becomes a draw) and stalemate (a decided draw)
+constexpr uint8_t UNKNOWN = 0, STALEMATE = 4;
+// No en passant capture after a move (see enPassantValue)
+constexpr int NO_EN_PASSANT = -1;
+
+constexpr uint32_t FILE_MAGIC = 0x42424143;  // "CABB"
+constexpr uint32_t FILE_VERSION = 3;         // 2: en passant after double pushes, 3: checksum
+
+// Slot 0 is the white king, slot 1 the black king, then the other pieces
+struct Pos {
+    int n;
+    int stm;
+    int sq[4];
+    int type[4];
+    int color[4];
+};
+
+struct Table {
+    std::string name;
+    int n = 0;
+    int type[4] = {KING, KING, 0, 0};
+    int color[4] = {WHITE, BLACK, 0, 0};
+    bool pawns = false;
+    uint64_t size = 0;
+    std::vector<uint8_t> packed;  // 4 positions per byte
+
+    int value(uint64_t index) const { return (packed[index >> 2] >> ((index & 3) * 2)) & 3; }
+};
+
+static std::vector<Table> tables;
+static int table_by_code[13 * 13];
+static std::atomic<int> max_pieces{0};
+
+static uint64_t knight_attacks[64], king_attacks[64], pawn_attacks[2][64];
+
+static int fileOf(int sq) { return sq & 7; }
+static int rankOf(int sq) { return sq >> 3; }
+
+static void initAttacks() {
+    static bool done = false;
+    if (done) return;
+    done = true;
+    const int knight[8][2] = {{1, 2}, {2, 1}, {2, -1}, {1, -2}, {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2}};
+    const int king[8][2] = {{0, 1}, {1, 1}, {1, 0}, {1, -1}, {0, -1}, {-1, -1}, {-1, 0}, {-1, 1}};
+    for (int sq = 0; sq < 64; ++sq) {
+        int f = fileOf(sq), r = rankOf(sq);
+        knight_attacks[sq] = king_attacks[sq] = 0;
+        for (int i = 0; i < 8; ++i) {
+            int kf = f + knight[i][0], kr = r + knight[i][1];
+            if (kf >= 0 && kf < 8 && kr >= 0 && kr < 8) knight_attacks[sq] |= 1ULL << (kr * 8 + kf);
+            kf = f + king[i][0], kr = r + king[i][1];
+            if (kf >= 0 && kf < 8 && kr >= 0 && kr < 8) king_attacks[sq] |= 1ULL << (kr * 8 + kf);
+        }
+        pawn_attacks[WHITE][sq] = pawn_attacks[BLACK][sq] = 0;
+        for (int df : {-1, 1}) {
+            if (f + df < 0 || f + df > 7) continue;
+            if (r < 7) pawn_attacks[WHITE][sq] |= 1ULL << ((r + 1) * 8 + f + df);
+            if (r > 0) pawn_attacks[BLACK][sq] |= 1ULL << ((r - 1) * 8 + f + df);
+        }
+    }
+}
+
+static uint64_t slide(int sq, uint64_t occ, const int (*dirs)[2]) {
+    uint64_t attacks = 0;
+    for (int d = 0; d < 4; ++d) {
+        int f = fileOf(sq) + dirs[d][0], r = rankOf(sq) + dirs[d][1];
+        while (f >= 0 && f < 8 && r >= 0 && r < 8) {
+            uint64_t bit = 1ULL << (r * 8 + f);
+            attacks |= bit;
+            if (occ & bit) break;
+            f += dirs[d][0], r += dirs[d][1];
+        }
+    }
+    return attacks;
+}
+
+static uint64_t attacks(int type, int color, int sq, uint64_t occ) {
+    static const int diagonal[4][2] = {{1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
+    static const int straight[4][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+    switch (type) {
+        case PAWN:   return pawn_attacks[color][sq];
+        case KNIGHT: return knight_attacks[sq];
+        case BISHOP: return slide(sq, occ, diagonal);
+        case ROOK:   return slide(sq, occ, straight);
+        case QUEEN:  return slide(sq, occ, diagonal) | slide(sq, occ, straight);
+        default:     return king_attacks[sq];
+    }
+}
+
+static uint64_t occupancy(const Pos& p) {
+    uint64_t occ = 0;
+    for (int i = 0; i < p.n; ++i) occ |= 1ULL << p.sq[i];
+    return occ;
+}
+
+static bool attacked(const Pos& p, int sq, int by) {
+    uint64_t occ = occupancy(p);
+    for (int i = 0; i < p.n; ++i) {
+        if (p.color[i] == by && (attacks(p.type[i], by, p.sq[i], occ) >> sq & 1)) return true;
+    }
+    return false;
+}
+
+static int slotAt(const Pos& p, int sq) {
+    for (int i = 0; i < p.n; ++i)
+        if (p.sq[i] == sq) return i;
+    return -1;
+}
+
+// Table lookup key: the non-king pieces in slot order, 12 kinds each (0 = none)
+static int materialCode(const Pos& p) {
+    int code = 0;
+    for (int i = p.n - 1; i >= 2; --i) code = code * 13 + 1 + p.type[i] + 6 * p.color[i];
+    return code;
+}
+
+// Colour-flip the position so that the stronger side is white, and order the pieces
+// white first, strongest first. Values are from the side to move's view, so they are
+// unaffected by the flip.
+static void normalize(Pos& p) {
+    int strength[2][2] = {{-1, -1}, {-1, -1}};
+    int count[2] = {0, 0};
+    for (int i = 2; i < p.n; ++i) strength[p.color[i]][count[p.color[i]]++] = p.type[i];
+    for (auto& s : strength) std::sort(s, s + 2, std::greater<int>());
+
+    bool flip = count[BLACK] > count[WHITE] ||
+                (count[BLACK] == count[WHITE] && std::lexicographical_compare(strength[WHITE], strength[WHITE] + 2,
+                                                                              strength[BLACK], strength[BLACK] + 2));
+    if (flip) {
+        std::swap(p.sq[0], p.sq[1]);
+        for (int i = 0; i < p.n; ++i) p.sq[i] ^= 56;
+        for (int i = 2; i < p.n; ++i) p.color[i] ^= 1;
+        p.stm ^= 1;
+    }
+    if (p.n == 4) {
+        bool swap = p.color[2] != p.color[3] ? p.color[2] == BLACK : p.type[2] < p.type[3];
+        if (swap) {
+            std::swap(p.sq[2], p.sq[3]);
+            std::swap(p.type[2], p.type[3]);
+            std::swap(p.color[2], p.color[3]);
+        }
+    }
+}
+
+// Bring the white king to files a-d (and ranks 1-4 when there are no pawns)
+static void mirror(Pos& p, bool pawns) {
+    if (fileOf(p.sq[0]) > 3)
+        for (int i = 0; i < p.n; ++i) p.sq[i] ^= 7;
+    if (!pawns && rankOf(p.sq[0]) > 3)
+        for (int i = 0; i < p.n; ++i) p.sq[i] ^= 56;
+}
+
+// Index of a mirrored position: side to move, white king, black king, then the pieces
+static uint64_t indexOf(const Table& t, const Pos& p) {
+    uint64_t index = p.stm * (t.pawns ? 32 : 16) + rankOf(p.sq[0]) * 4 + fileOf(p.sq[0]);
+    for (int i = 1; i < p.n; ++i) index = index * 64 + p.sq[i];
+    return index;
+}
+
+static void decode(const Table& t, uint64_t index, Pos& p) {
+    p.n = t.n;
+    for (int i = t.n - 1; i >= 1; --i) {
+        p.sq[i] = index & 63;
+        index >>= 6;
+    }
+    int kings = t.pawns ? 32 : 16;
+    p.stm = static_cast<int>(index / kings);
+    int wk = static_cast<int>(index % kings);
+    p.sq[0] = (wk / 4) * 8 + wk % 4;
+    for (int i = 0; i < t.n; ++i) {
+        p.type[i] = t.type[i];
+        p.color[i] = t.color[i];
+    }
+}
+
+static bool isValid(const Pos& p) {
+    for (int i = 0; i < p.n; ++i) {
+        if (p.type[i] == PAWN && (rankOf(p.sq[i]) == 0 || rankOf(p.sq[i]) == 7)) return false;
+        for (int j = i + 1; j < p.n; ++j)
+            if (p.sq[i] == p.sq[j]) return false;
+    }
+    // The side that just moved cannot be in check (this also keeps the kings apart)
+    return !attacked(p, p.sq[p.stm ^ 1], p.stm);
+}
+
+static int lookup(Pos p);
+
+// Tables are indexed without an en passant square, so a double push next to an enemy pawn
+// leads to a position the table does not hold: the same position plus the en passant capture.
+// Value of the best such capture for the side that pushed (to move after it, and choosing
+// between the two when both pawns can take), or NO_EN_PASSANT when there is none.
+static int enPassantValue(const Pos& child, int pushed) {
+    int to = child.sq[pushed], behind = to + (child.color[pushed] == WHITE ? -8 : 8);
+    int best = NO_EN_PASSANT;
+    for (int j = 2; j < child.n; ++j) {
+        if (child.type[j] != PAWN || child.color[j] != child.stm || rankOf(child.sq[j]) != rankOf(to) ||
+            std::abs(fileOf(child.sq[j]) - fileOf(to)) != 1)
+            continue;
+        Pos after = child;
+        after.sq[j] = behind;
+        after.sq[pushed] = after.sq[after.n - 1];
+        after.type[pushed] = after.type[after.n - 1];
+        after.color[pushed] = after.color[after.n - 1];
+        --after.n;
+        after.stm ^= 1;
+        if (attacked(after, after.sq[child.stm], after.stm)) continue;
+        int v = lookup(after);
+        // The capturing side prefers the pusher lost, then drawn
+        if (best == NO_EN_PASSANT || v == LOSS || (v == DRAW && best == WIN)) best = v;
+    }
+    return best;
+}
+
+// Calls visit(child, inTable, enPassant) for every legal move, enPassant being the value of
+// the opponent's en passant replies after a double push (enPassantValue). Children outside
+// the table (captures and promotions) are passed unnormalized.
+template <typename F>
+static void forEachMove(const Pos& p, F&& visit) {
+    uint64_t occ = occupancy(p);
+    uint64_t own = 0;
+    for (int i = 0; i < p.n; ++i)
+        if (p.color[i] == p.stm) own |= 1ULL << p.sq[i];
+
+    for (int i = 0; i < p.n; ++i) {
+        if (p.color[i] != p.stm) continue;
+        int from = p.sq[i];
+        uint64_t targets;
+        if (p.type[i] == PAWN) {
+            int up = p.stm == WHITE ? 8 : -8;
+            targets = pawn_attacks[p.stm][from] & occ & ~own;
+            if (!(occ >> (from + up) & 1)) {
+                targets |= 1ULL << (from + up);
+                int start = p.stm == WHITE ? 1 : 6;
+                if (rankOf(from) == start && !(occ >> (from + 2 * up) & 1)) targets |= 1ULL << (from + 2 * up);
+            }
+        } else {
+            targets = attacks(p.type[i], p.stm, from, occ) & ~own;
+        }
+
+        while (targets) {
+            int to = __builtin_ctzll(targets);
+            targets &= targets - 1;
+            int captured = slotAt(p, to);
+            if (captured >= 0 && captured < 2) continue;  // Kings are never captured
+
+            Pos child = p;
+            child.sq[i] = to;
+            child.stm ^= 1;
+            if (captured >= 0) {
+                child.sq[captured] = child.sq[child.n - 1];
+                child.type[captured] = child.type[child.n - 1];
+                child.color[captured] = child.color[child.n - 1];
+                --child.n;
+            }
+            if (attacked(child, child.sq[p.stm], child.stm)) continue;
+
+            if (p.type[i] == PAWN && (rankOf(to) == 0 || rankOf(to) == 7)) {
+                // A capture moves the last slot into the captured one, possibly the pawn itself
+                int slot = (captured >= 0 && i == child.n) ? captured : i;
+                for (int promoted : {QUEEN, ROOK, BISHOP, KNIGHT}) {
+                    child.type[slot] = promoted;
+                    visit(child, false, NO_EN_PASSANT);
+                }
+            } else {
+                bool doublePush = p.type[i] == PAWN && std::abs(to - from) == 16;
+                visit(child, captured < 0, doublePush ? enPassantValue(child, i) : NO_EN_PASSANT);
+            }
+        }
+    }
+}
+
+// Calls visit(parent, enPassant) for every position that reaches `p` with a quiet move (no
+// capture or promotion), i.e. the predecessors within the same table; enPassant as in
+// forEachMove.
+template <typename F>
+static void forEachUnmove(const Pos& p, F&& visit) {
+    int mover = p.stm ^ 1;
+    uint64_t occ = occupancy(p);
+    for (int i = 0; i < p.n; ++i) {
+        if (p.color[i] != mover) continue;
+        int to = p.sq[i];
+        uint64_t sources;
+        if (p.type[i] == PAWN) {
+            int down = mover == WHITE ? -8 : 8;
+            int start = mover == WHITE ? 1 : 6;
+            sources = 0;
+            int from = to + down;
+            if (!(occ >> from & 1) && rankOf(from) != 0 && rankOf(from) != 7) {
+                sources |= 1ULL << from;
+                if (rankOf(from + down) == start && !(occ >> (from + down) & 1)) sources |= 1ULL << (from + down);
+            }
+        } else {
+            sources = attacks(p.type[i], mover, to, occ) & ~occ;
+        }
+
+        while (sources) {
+            Pos parent = p;
+            parent.sq[i] = __builtin_ctzll(sources);
+            sources &= sources - 1;
+            parent.stm = mover;
+            if (attacked(parent, parent.sq[p.stm], mover)) continue;
+            bool doublePush = p.type[i] == PAWN && std::abs(to - parent.sq[i]) == 16;
+            visit(parent, doublePush ? enPassantValue(p, i) : NO_EN_PASSANT);
+        }
+    }
+}
+
+static const Table* tableFor(const Pos& p) {
+    int id = table_by_code[materialCode(p)];
+    return id < 0 || tables[id].packed.empty() ? nullptr : &tables[id];
+}
+
+// Value of a position from another (already generated) table
+static int lookup(Pos p) {
+    if (p.n == 2) return DRAW;
+    normalize(p);
+    const Table* t = tableFor(p);
+    if (!t) return DRAW;
+    mirror(p, t->pawns);
+    return t->value(indexOf(*t, p));
+}
+
+template <typename F>
+static void parallelFor(uint64_t n, int threads, F&& body) {
+    std::vector<std::thread> workers;
+    uint64_t chunk = (n + threads - 1) / threads;
+    for (int t = 0; t < threads; ++t) {
+        uint64_t begin = std::min<uint64_t>(n, t * chunk), end = std::min<uint64_t>(n, begin + chunk);
+        workers.emplace_back([&, t, begin, end] { body(begin, end, t); });
+    }
+    for (auto& w : workers) w.join();
+}
+
+// Retrograde analysis: every position counts its moves that are not known to lose; decided
+// positions are then propagated backwards one ply at a time. A predecessor of a lost position
+// is won, and a position whose count drops to zero is lost. Whatever is left is a draw.
+// A double push the opponent can answer en passant is worth no more than that capture: it
+// never counts when the capture wins, and it never wins when the capture draws.
+static void generate(Table& t, int threads) {
+    std::unique_ptr<std::atomic<uint8_t>[]> state(new std::atomic<uint8_t>[t.size]);
+    std::unique_ptr<std::atomic<uint8_t>[]> pending(new std::atomic<uint8_t>[t.size]);
+    std::vector<std::vector<uint32_t>> next(threads);
+
+    parallelFor(t.size, threads, [&](uint64_t begin, uint64_t end, int id) {
+        Pos p;
+        for (uint64_t index = begin; index < end; ++index) {
+            decode(t, index, p);
+            pending[index].store(0, std::memory_order_relaxed);
+            if (!isValid(p)) {
+                state[index].store(INVALID, std::memory_order_relaxed);
+                continue;
+            }
+
+            int moves = 0, count = 0;
+            bool win = false;
+            forEachMove(p, [&](const Pos& child, bool inTable, int enPassant) {
+                ++moves;
+                if (enPassant == LOSS) return;  // Taken en passant, and lost
+                int v = inTable ? DRAW : lookup(child);
+                if (v == LOSS) win = true;
+                else if (inTable || v == DRAW) ++count;  // Moves into won positions never help
+            });
+
+            uint8_t v = UNKNOWN;
+            if (moves == 0) v = attacked(p, p.sq[p.stm], p.stm ^ 1) ? LOSS : STALEMATE;
+            else if (win) v = WIN;
+            else if (count == 0) v = LOSS;
+            state[index].store(v, std::memory_order_relaxed);
+            pending[index].store(static_cast<uint8_t>(count), std::memory_order_relaxed);
+            if (v == WIN || v == LOSS) next[id].push_back(static_cast<uint32_t>(index));
+        }
+    });
+
+    std::vector<uint32_t> wave;
+    while (true) {
+        wave.clear();
+        for (auto& n : next) {
+            wave.insert(wave.end(), n.begin(), n.end());
+            n.clear();
+        }
+        if (wave.empty()) break;
+
+        parallelFor(wave.size(), threads, [&](uint64_t begin, uint64_t end, int id) {
+            Pos p;
+            for (uint64_t w = begin; w < end; ++w) {
+                decode(t, wave[w], p);
+                bool lost = state[wave[w]].load(std::memory_order_relaxed) == LOSS;
+                forEachUnmove(p, [&](Pos parent, int enPassant) {
+                    if (enPassant == LOSS || (lost && enPassant == DRAW)) return;
+                    mirror(parent, t.pawns);
+                    uint64_t index = indexOf(t, parent);
+                    if (state[index].load(std::memory_order_relaxed) != UNKNOWN) return;
+                    if (lost) {
+                        uint8_t expected = UNKNOWN;
+                        if (state[index].compare_exchange_strong(expected, WIN))
+                            next[id].push_back(static_cast<uint32_t>(index));
+                    } else if (pending[index].fetch_sub(1) == 1) {
+                        state[index].store(LOSS, std::memory_order_relaxed);
+                        next[id].push_back(static_cast<uint32_t>(index));
+                    }
+                });
+            }
+        });
+    }
+
+    t.packed.assign((t.size + 3) / 4, 0);
+    for (uint64_t index = 0; index < t.size; ++index) {
+        uint8_t s = state[index].load(std::memory_order_relaxed);
+        uint8_t v = (s == WIN || s == LOSS || s == INVALID) ? s : DRAW;
+        t.packed[index >> 2] |= v << ((index & 3) * 2);
+    }
+}
+
+// FNV-1a over the packed values, stored after the header so a damaged body is not probed
+static uint64_t checksum(const std::vector<uint8_t>& packed) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (uint8_t byte : packed) hash = (hash ^ byte) * 0x100000001b3ULL;
+    return hash;
+}
+
+static bool load(Table& t, const std::string& file) {
+    std::ifstream in(file, std::ios::binary);
+    if (!in) return false;
+    uint32_t magic = 0, version = 0;
+    uint64_t size = 0, sum = 0;
+    in.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+    in.read(reinterpret_cast<char*>(&version), sizeof(version));
+    in.read(reinterpret_cast<char*>(&size), sizeof(size));
+    in.read(reinterpret_cast<char*>(&sum), sizeof(sum));
+    if (!in || magic != FILE_MAGIC || version != FILE_VERSION || size != t.size) return false;
+    t.packed.resize((t.size + 3) / 4);
+    in.read(reinterpret_cast<char*>(t.packed.data()), t.packed.size());
+    if (!in || in.peek() != EOF || checksum(t.packed) != sum) t.packed.clear();
+    return !t.packed.empty();
+}
+
+// Written to a file of this process and renamed over `file` once complete, so engines
+// sharing the directory never read a table halfway through being written
+static bool save(const Table& t, const std::string& file) {
+    std::string temporary = file + "." + std::to_string(getpid()) + ".tmp";
+    uint64_t sum = checksum(t.packed);
+    {
+        std::ofstream out(temporary, std::ios::binary);
+        out.write(reinterpret_cast<const char*>(&FILE_MAGIC), sizeof(FILE_MAGIC));
+        out.write(reinterpret_cast<const char*>(&FILE_VERSION), sizeof(FILE_VERSION));
+        out.write(reinterpret_cast<const char*>(&t.size), sizeof(t.size));
+        out.write(reinterpret_cast<const char*>(&sum), sizeof(sum));
+        out.write(reinterpret_cast<const char*>(t.packed.data()), t.packed.size());
+        out.close();
+        if (!out) {
+            LOG_ERROR("Could not write bitbase " << temporary);
+            std::remove(temporary.c_str());
+            return false;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(temporary, file, ec);
+    if (ec) {
+        LOG_ERROR("Could not replace bitbase " << file << ": " << ec.message());
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+// All 3 and 4 piece material signatures with white as the stronger side, ordered so that
+// every table comes after the tables its captures and promotions lead to.
+static void buildTableList() {
+    if (!tables.empty()) return;
+    const char names[] = "PNBRQ";
+    auto add = [&](std::vector<std::pair<int, int>> pieces) {
+        Table t;
+        t.n = 2 + static_cast<int>(pieces.size());
+        t.name = "K";
+        for (size_t i = 0; i < pieces.size(); ++i) {
+            t.type[2 + i] = pieces[i].first;
+            t.color[2 + i] = pieces[i].second;
+            t.pawns |= pieces[i].first == PAWN;
+            if (pieces[i].second == BLACK && (i == 0 || pieces[i - 1].second == WHITE)) t.name += "K";
+            t.name += names[pieces[i].first];
+        }
+        if (t.name.find('K', 1) == std::string::npos) t.name += "K";
+        t.size = (t.pawns ? 32 : 16) * 2;
+        for (int i = 1; i < t.n; ++i) t.size *= 64;
+        tables.push_back(t);
+    };
+    for (int x = QUEEN; x >= PAWN; --x) add({{x, WHITE}});
+    for (int x = QUEEN; x >= PAWN; --x)
+        for (int y = x; y >= PAWN; --y) {
+            add({{x, WHITE}, {y, WHITE}});
+            add({{x, WHITE}, {y, BLACK}});
+        }
+
+    auto pawnCount = [](const Table& t) {
+        return std::count(t.type + 2, t.type + t.n, PAWN);
+    };
+    std::stable_sort(tables.begin(), tables.end(), [&](const Table& a, const Table& b) {
+        return a.n != b.n ? a.n < b.n : pawnCount(a) < pawnCount(b);
+    });
+
+    std::fill(std::begin(table_by_code), std::end(table_by_code), -1);
+    for (size_t i = 0; i < tables.size(); ++i) {
+        Pos p;
+        p.n = tables[i].n;
+        std::copy(tables[i].type, tables[i].type + 4, p.type);
+        std::copy(tables[i].color, tables[i].color + 4, p.color);
+        table_by_code[materialCode(p)] = static_cast<int>(i);
+    }
+}
+
+int init(const std::string& dir, int maxPieces) {
+    initAttacks();
+    buildTableList();
+    max_pieces = 0;
+    maxPieces = std::min(maxPieces, 4);
+    if (maxPieces < 3) return 0;
+
+    int available = 0;
+    for (auto& t : tables) {
+        if (t.n > maxPieces) break;
+        if (!t.packed.empty() || load(t, dir + "/" + t.name + ".bb")) ++available;
+    }
+    max_pieces = maxPieces;
+    DEBUG_PRINT("[DEBUG] " << available << " bitbases loaded (up to " << maxPieces << " pieces)");
+    return available;
+}
+
+int build(const std::string& dir, int maxPieces) {
+    initAttacks();
+    buildTableList();
+    maxPieces = std::min(maxPieces, 4);
+
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+
+    // In table order, so the tables a generation looks up are loaded or generated already
+    int written = 0;
+    for (auto& t : tables) {
+        if (t.n > maxPieces) break;
+        std::string file = dir + "/" + t.name + ".bb";
+        if (load(t, file)) continue;
+        if (t.packed.empty()) {
+            DEBUG_PRINT("[DEBUG] Generating bitbase " << t.name);
+            generate(t, threads);
+        }
+        if (save(t, file)) ++written;
+    }
+    return written;
+}
+
+int maxPieces() {
+    return max_pieces.load(std::memory_order_relaxed);
+}
+
+bool probe(const Board& board, int& wdl) {
+    Bitboard occ = board.occ();
+    int n = occ.count();
+    if (n > maxPieces() || n < 3) return false;
+    if (!board.castlingRights().isEmpty() || board.enpassantSq() != Square::NO_SQ) return false;
+
+    Pos p;
+    p.n = 2;
+    p.stm = board.sideToMove() == Color::WHITE ? WHITE : BLACK;
+    while (occ) {
+        int sq = occ.pop();
+        Piece piece = board.at(Square(sq));
+        int type = static_cast<int>(piece.type());
+        int color = piece.color() == Color::WHITE ? WHITE : BLACK;
+        int slot = type == KING ? color : p.n++;
+        p.sq[slot] = sq;
+        p.type[slot] = type;
+        p.color[slot] = color;
+    }
+
+    normalize(p);
+    const Table* t = tableFor(p);
+    if (!t) return false;
+    mirror(p, t->pawns);
+    int v = t->value(indexOf(*t, p));
+    if (v == INVALID) return false;
+    wdl = v == WIN ? 1 : v == LOSS ? -1 : 0;
+    return true;
+}
+
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <string>
+
+#include "../../chess-library/include/chess.hpp"
+
+// Built-in win/draw/loss bitbases for every 3- and 4-piece ending (KPK, KRK, KQK, KBNK, KRKP, ...),
+// for deployments without Syzygy files. Tables are produced by retrograde analysis on all cores,
+// stored with 2 bits per position and cached on disk, so they are only generated once.
+namespace Bitbases {
+    // Load the tables for up to `maxPieces` pieces (kings included, 3 or 4) found in `dir`.
+    // Missing tables are not generated (see build) and simply not probed. Returns the number
+    // of tables loaded.
+    int init(const std::string& dir, int maxPieces);
+
+    // Generate the tables for up to `maxPieces` pieces missing from `dir` on all cores and save
+    // them there: seconds for 3 pieces, minutes for 4. Returns the number of tables written.
+    int build(const std::string& dir, int maxPieces);
+
+    // Largest piece count covered by the loaded tables (0 when disabled).
+    int maxPieces();
+
+    // Result for the side to move: 1 win, 0 draw, -1 loss. Returns false for positions not
+    // covered (too many pieces, castling rights or an en passant square).
+    bool probe(const chess::Board& board, int& wdl);
+}
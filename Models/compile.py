@@ -38,25 +38,33 @@ def parse_depth_input(s):
             print("Invalid input for depth. Please provide a range (x-y) or comma separated integers.", file=sys.stderr)
             sys.exit(1)
 
-def compile_version_new(base_filename, compile_normal, compile_debug, compile_test):
+def compile_version_new(base_filename, compile_normal, compile_debug, compile_test, compile_profile=False, compile_alloc=False):
     # Determine if version is 2.x or above
     is_nnue = base_filename.startswith("2.")
 
-    # Common NNUE files
-    nnue_files = ["nnue_eval.cpp", "evaluateBoardNNUE.cpp", "nnue_input_from_board.cpp"]
+    # Source files shared by the 2.x engines (NNUE evaluation, opening book, tablebases)
+    common_files = ["nnue_eval.cpp", "evaluateBoardNNUE.cpp", "nnue_input_from_board.cpp", "opening_book.cpp", "syzygy.cpp", "bitbase.cpp", "perft.cpp", "perf_counters.cpp", "alloc_tracker.cpp", "log.cpp", "hash_memory.cpp"]
 
-    def make_cmd(debug=False, test=False):
+    def make_cmd(debug=False, test=False, profile=False, alloc=False):
         cmd = ["g++", "-std=c++17", "-O3", "-march=native", "-flto"]
         if debug:
             cmd += ["-D", "DEBUG"]
         if test:
             cmd += ["-D", "TEST"]
+        if profile:
+            cmd += ["-D", "PROFILE"]
+        if alloc:
+            cmd += ["-D", "ALLOC_TRACK"]
 
         output_name = f"bin/Chessape_{base_filename}"
         if debug:
             output_name += "_DEBUG"
         elif test:
             output_name += "_TEST"
+        elif profile:
+            output_name += "_PROFILE"
+        elif alloc:
+            output_name += "_ALLOC"
         cmd += ["-o", output_name]
 
         # Always include the main file
@@ -64,11 +72,26 @@ def compile_version_new(base_filename, compile_normal, compile_debug, compile_te
 
         # Conditionally add NNUE-related files
         if is_nnue:
-            cmd.extend(nnue_files)
+            cmd.extend(common_files)
+
+        # Syzygy tablebases through Fathom, when it is checked out next to chess-library
+        if is_nnue and has_fathom:
+            cmd += ["-D", "SYZYGY", fathom_object]
 
         cmd.append("-lsqlite3")
         return cmd
 
+    # Fathom is plain C: build its object once and link it into every variant
+    fathom_source = "../../Fathom/src/tbprobe.c"
+    fathom_object = "bin/tbprobe.o"
+    has_fathom = is_nnue and os.path.exists(fathom_source)
+    if has_fathom:
+        cmd = ["gcc", "-std=gnu11", "-O3", "-march=native", "-c", fathom_source, "-o", fathom_object]
+        print("Compiling:", ' '.join(cmd))
+        if subprocess.run(cmd).returncode != 0:
+            print("Failed to compile Fathom, building without Syzygy support", file=sys.stderr)
+            has_fathom = False
+
     success = True
     if compile_debug:
         cmd = make_cmd(debug=True)
@@ -94,6 +117,22 @@ def compile_version_new(base_filename, compile_normal, compile_debug, compile_te
             print(f"Failed to compile TEST version for Chessape_{base_filename}", file=sys.stderr)
             success = False
 
+    if compile_profile:
+        cmd = make_cmd(profile=True)
+        print("Compiling:", ' '.join(cmd))
+        result = subprocess.run(cmd)
+        if result.returncode != 0:
+            print(f"Failed to compile PROFILE version for Chessape_{base_filename}", file=sys.stderr)
+            success = False
+
+    if compile_alloc:
+        cmd = make_cmd(alloc=True)
+        print("Compiling:", ' '.join(cmd))
+        result = subprocess.run(cmd)
+        if result.returncode != 0:
+            print(f"Failed to compile ALLOC version for Chessape_{base_filename}", file=sys.stderr)
+            success = False
+
     return success
 
 
@@ -160,8 +199,8 @@ if __name__ == "__main__":
     base_files = file_input.split()
 
     for base_file in base_files:
-        compile_choice = input(f"Which versions do you want to compile for Chessape_{base_file}? Options: NORMAL, DEBUG, TEST, or ALL: ").strip().upper()
-        compile_normal = compile_debug = compile_test = False
+        compile_choice = input(f"Which versions do you want to compile for Chessape_{base_file}? Options: NORMAL, DEBUG, TEST, PROFILE (2.x only), ALLOC (2.x only), or ALL: ").strip().upper()
+        compile_normal = compile_debug = compile_test = compile_profile = compile_alloc = False
         if compile_choice == "ALL":
             compile_normal = compile_debug = compile_test = True
         elif compile_choice == "NORMAL":
@@ -170,6 +209,10 @@ if __name__ == "__main__":
             compile_debug = True
         elif compile_choice == "TEST":
             compile_test = True
+        elif compile_choice == "PROFILE" and base_file.startswith("2."):
+            compile_profile = True
+        elif compile_choice == "ALLOC" and base_file.startswith("2."):
+            compile_alloc = True
         else:
             print("Invalid compile version option.", file=sys.stderr)
             sys.exit(1)
@@ -183,7 +226,7 @@ if __name__ == "__main__":
                 print(f"Compilation failed for {base_file}.", file=sys.stderr)
                 sys.exit(1)
         else:
-            if compile_version_new(base_file, compile_normal, compile_debug, compile_test):
+            if compile_version_new(base_file, compile_normal, compile_debug, compile_test, compile_profile, compile_alloc):
                 print(f"All selected variants compiled successfully for {base_file}!")
             else:
                 print(f"Compilation failed for {base_file}.", file=sys.stderr)
@@ -1,19 +1,21 @@
 #include "nnue_eval.h"
+#include "profiler.h"
+#include "log.h"
 #include "../../chess-library/include/chess.hpp"
-#include <iostream>
-#include <vector>
 
 extern NNUE nnue_model;
-std::vector<float> nnue_input_from_board(const chess::Board& board);
+void nnue_input_from_board(const chess::Board& board, float* input);
 
 short evaluateBoardNNUE(const chess::Board& board) {
-    std::cerr << "[DEBUG] Inside evaluateBoardNNUE" << std::endl;
+    float input[NNUE::INPUTS];
+    nnue_input_from_board(board, input);
 
-    auto input = nnue_input_from_board(board);
-    std::cerr << "[DEBUG] Input vector size: " << input.size() << std::endl;
-
-    float score = nnue_model.evaluate(input);
-    std::cerr << "[DEBUG] Score from NNUE: " << score << std::endl;
+    float score;
+    {
+        PROFILE_SCOPE(NNUE);
+        score = nnue_model.evaluate(input);
+    }
+    LOG_TRACE("NNUE score: " << score);
 
     return static_cast<short>(score);
 }
@@ -0,0 +1,72 @@
+#include "hash_memory.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+static constexpr size_t HUGE_PAGE = 2 * 1024 * 1024;
+
+HashMemory::~HashMemory() {
+    release();
+}
+
+void HashMemory::release() {
+#ifdef __linux__
+    if (mappedBytes) munmap(memory, mappedBytes);
+    else
+#endif
+        std::free(memory);
+    memory = nullptr;
+    bytes = mappedBytes = 0;
+    huge = false;
+}
+
+bool HashMemory::resize(size_t size) {
+    release();
+    if (size == 0) return true;
+
+#ifdef __linux__
+    // Map one huge page more than needed and trim both ends, so the block starts on a 2 MB
+    // boundary and each huge page backs table entries only
+    size_t rounded = (size + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE;
+    void* mapped = mmap(nullptr, rounded + HUGE_PAGE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapped != MAP_FAILED) {
+        uintptr_t start = reinterpret_cast<uintptr_t>(mapped);
+        uintptr_t aligned = (start + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE;
+        if (aligned > start) munmap(mapped, aligned - start);
+        size_t tail = start + rounded + HUGE_PAGE - (aligned + rounded);
+        if (tail) munmap(reinterpret_cast<void*>(aligned + rounded), tail);
+
+        memory = reinterpret_cast<void*>(aligned);
+        mappedBytes = rounded;
+#ifdef MADV_HUGEPAGE
+        huge = madvise(memory, mappedBytes, MADV_HUGEPAGE) == 0;
+#endif
+        bytes = size;
+        return true;     // Anonymous pages read as zero until written
+    }
+#endif
+
+    memory = std::calloc(size, 1);
+    if (!memory) return false;
+    bytes = size;
+    return true;
+}
+
+void HashMemory::clear(int threads) {
+    if (!memory) return;
+    // Chunks of whole huge pages, so no page is shared by two threads
+    size_t chunk = (bytes / std::max(1, threads) + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE;
+    char* base = static_cast<char*>(memory);
+    std::vector<std::thread> workers;
+    for (size_t offset = chunk; offset < bytes; offset += chunk)
+        workers.emplace_back([=]() { std::memset(base + offset, 0, std::min(chunk, bytes - offset)); });
+    std::memset(base, 0, std::min(chunk, bytes));
+    for (auto& w : workers) w.join();
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstddef>
+
+// Backing memory for the large tables (position counts, perft hash). With tables of several GB
+// every random probe misses the TLB on 4 KB pages, so the block is an anonymous mapping aligned
+// to 2 MB and advised for transparent huge pages. Kernels or systems without them simply keep
+// normal pages, and if the mapping itself fails the block comes from the heap instead.
+class HashMemory {
+public:
+    HashMemory() = default;
+    ~HashMemory();
+    HashMemory(const HashMemory&) = delete;
+    HashMemory& operator=(const HashMemory&) = delete;
+
+    // Replace the block by `bytes` of zeroes (none for 0). False, with no block, if neither the
+    // mapping nor the heap can provide it.
+    bool resize(size_t bytes);
+
+    // Zero the block, split in contiguous chunks among `threads` threads. Pages are touched by
+    // the thread clearing them, which also spreads the page faults of a fresh block.
+    void clear(int threads);
+
+    void* data() const { return memory; }
+    size_t size() const { return bytes; }
+    bool hugePages() const { return huge; }   // Whether the kernel accepted the huge page advice
+
+private:
+    void* memory = nullptr;
+    size_t bytes = 0;
+    size_t mappedBytes = 0;    // 0 when the block came from the heap
+    bool huge = false;
+
+    void release();
+};
@@ -0,0 +1,153 @@
+#include "log.h"
+#include <chrono>
+#include <csignal>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+namespace Trace {
+
+static const char* const EVENT_NAMES[EVENT_COUNT] = {
+    "search_start", "search_end", "node", "cutoff", "null_cutoff", "tablebase"};
+static const char* const FIELD_NAMES[EVENT_COUNT][2] = {
+    {"min_depth", "max_depth"}, {"score", "nodes"}, {"depth", "eval"},
+    {"move", "score"}, {"depth", "score"}, {"wdl", "source"}};
+
+// Rings are never freed: a thread that ends hands its ring over to the next one
+static Ring* rings[MAX_RINGS];
+static std::atomic<int> ringCount{0};
+static std::mutex rings_mutex;
+static const auto start = std::chrono::steady_clock::now();
+
+uint64_t now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+static Ring* acquire() {
+    std::lock_guard<std::mutex> lock(rings_mutex);
+    int count = ringCount.load(std::memory_order_relaxed);
+    for (int i = 0; i < count; ++i) {
+        if (!rings[i]->owned.load()) {
+            rings[i]->owned = true;
+            return rings[i];
+        }
+    }
+    Ring* ring = new Ring();
+    ring->owned = true;
+    if (count < MAX_RINGS) {  // Past MAX_RINGS the ring is still written, just never dumped
+        ring->id = count;
+        rings[count] = ring;
+        ringCount.store(count + 1, std::memory_order_release);
+    }
+    return ring;
+}
+
+namespace {
+struct Owner {
+    Ring* ring = acquire();
+    ~Owner() { ring->owned = false; }
+};
+}
+
+Ring& local() {
+    thread_local Owner owner;
+    return *owner.ring;
+}
+
+// Formatting by hand, without allocation or locale, so the crash handler can use it too
+static char* append(char* p, const char* s) {
+    while (*s) *p++ = *s++;
+    return p;
+}
+
+static char* append(char* p, int64_t value) {
+    uint64_t v = value < 0 ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+    if (value < 0) *p++ = '-';
+    char digits[20];
+    int n = 0;
+    do {
+        digits[n++] = static_cast<char>('0' + v % 10);
+        v /= 10;
+    } while (v);
+    while (n) *p++ = digits[--n];
+    return p;
+}
+
+template <typename Sink>
+static void dumpRings(Sink sink) {
+    char line[160];
+    int count = ringCount.load(std::memory_order_acquire);
+    for (int i = 0; i < count; ++i) {
+        const Ring& ring = *rings[i];
+        uint64_t head = ring.head.load(std::memory_order_acquire);
+        uint64_t first = head > CAPACITY ? head - CAPACITY : 0;
+        char* p = append(line, "thread slot ");
+        p = append(p, static_cast<int64_t>(ring.id));
+        p = append(p, ": last ");
+        p = append(p, static_cast<int64_t>(head - first));
+        p = append(p, " of ");
+        p = append(p, static_cast<int64_t>(head));
+        p = append(p, " events\n");
+        sink(line, p - line);
+        for (uint64_t n = first; n < head; ++n) {
+            Record r = ring.records[n & (CAPACITY - 1)];
+            if (r.event >= EVENT_COUNT) continue;
+            p = append(line, "  ");
+            p = append(p, static_cast<int64_t>(r.time / 1000));
+            p = append(p, " us ");
+            p = append(p, EVENT_NAMES[r.event]);
+            p = append(p, " ply ");
+            p = append(p, static_cast<int64_t>(r.ply));
+            p = append(p, " ");
+            p = append(p, FIELD_NAMES[r.event][0]);
+            p = append(p, " ");
+            p = append(p, static_cast<int64_t>(r.a));
+            p = append(p, " ");
+            p = append(p, FIELD_NAMES[r.event][1]);
+            p = append(p, " ");
+            p = append(p, static_cast<int64_t>(r.b));
+            p = append(p, "\n");
+            sink(line, p - line);
+        }
+    }
+}
+
+void dump(std::ostream& out) {
+    dumpRings([&](const char* s, std::size_t n) { out.write(s, n); });
+    out.flush();
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+
+static void onCrash(int sig) {
+    char line[80];
+    char* p = append(line, "\n*** Crashed with signal ");
+    p = append(p, static_cast<int64_t>(sig));
+    p = append(p, ", last trace events:\n");
+    auto sink = [](const char* s, std::size_t n) {
+        ssize_t written = write(STDERR_FILENO, s, n);
+        (void)written;
+    };
+    sink(line, p - line);
+    dumpRings(sink);
+    raise(sig);  // SA_RESETHAND restored the default action
+}
+
+void installCrashHandler() {
+    for (int sig : {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT}) {
+        struct sigaction action = {};
+        action.sa_handler = onCrash;
+        sigemptyset(&action.sa_mask);
+        action.sa_flags = SA_RESETHAND;
+        sigaction(sig, &action, nullptr);
+    }
+}
+
+#else
+
+void installCrashHandler() {}
+
+#endif
+
+}
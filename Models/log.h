@@ -0,0 +1,101 @@
+#pragma once
+
+// Logging and tracing.
+// LOG_ERROR, LOG_WARN, LOG_INFO, LOG_DEBUG and LOG_TRACE write one line to stderr, never to the
+// UCI stream. Levels below LOG_LEVEL are compiled out: the default is INFO, DEBUG builds get
+// DEBUG, and e.g. -D LOG_LEVEL=0 keeps everything.
+// TRACE_EVENT appends a binary record to the calling thread's ring buffer: no lock, no
+// allocation and no formatting, so it stays on in release builds. The last TRACE_CAPACITY
+// events of each thread are printed on demand (`trace` command) and when the engine crashes.
+
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <ostream>
+
+#define LOG_LEVEL_TRACE 0
+#define LOG_LEVEL_DEBUG 1
+#define LOG_LEVEL_INFO  2
+#define LOG_LEVEL_WARN  3
+#define LOG_LEVEL_ERROR 4
+#define LOG_LEVEL_OFF   5
+
+#ifndef LOG_LEVEL
+#ifdef DEBUG
+#define LOG_LEVEL LOG_LEVEL_DEBUG
+#else
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+#endif
+
+namespace Log {
+inline std::mutex log_mutex;
+inline const char* const LEVEL_NAMES[] = {"trace", "debug", "info", "warn", "error"};
+}
+
+// The condition is a constant, so disabled levels leave no code behind
+#define LOG_AT(level, x)                                                                    \
+    do {                                                                                    \
+        if (level >= LOG_LEVEL) {                                                           \
+            std::lock_guard<std::mutex> log_lock(Log::log_mutex);                           \
+            std::cerr << "[" << Log::LEVEL_NAMES[level] << "] " << x << std::endl;          \
+        }                                                                                   \
+    } while (0)
+
+#define LOG_TRACE(x) LOG_AT(LOG_LEVEL_TRACE, x)
+#define LOG_DEBUG(x) LOG_AT(LOG_LEVEL_DEBUG, x)
+#define LOG_INFO(x)  LOG_AT(LOG_LEVEL_INFO, x)
+#define LOG_WARN(x)  LOG_AT(LOG_LEVEL_WARN, x)
+#define LOG_ERROR(x) LOG_AT(LOG_LEVEL_ERROR, x)
+
+namespace Trace {
+
+// What a and b hold is given next to each event
+enum Event : uint16_t {
+    SEARCH_START,   // a: min depth, b: max depth
+    SEARCH_END,     // a: score, b: nodes (low 32 bits)
+    NODE,           // a: depth, b: current evaluation
+    CUTOFF,         // a: move number, b: score
+    NULL_CUTOFF,    // a: depth, b: score
+    TABLEBASE,      // a: WDL, b: 1 for Syzygy, 2 for bitbases
+    EVENT_COUNT
+};
+
+constexpr uint32_t CAPACITY = 4096;  // Records per thread, a power of two
+constexpr int MAX_RINGS = 256;
+
+struct Record {
+    uint64_t time;    // Nanoseconds since the engine started
+    uint16_t event;
+    uint16_t ply;
+    int32_t a, b;
+};
+
+// Written by its thread only; readers may see a record being overwritten, never a crash
+struct Ring {
+    std::atomic<uint64_t> head{0};   // Records written so far
+    std::atomic<bool> owned{false};  // Whether a live thread writes to it
+    int id = 0;
+    Record records[CAPACITY];
+};
+
+inline std::atomic<bool> enabled{true};
+
+Ring& local();
+uint64_t now();
+
+inline void record(Event event, int ply, int32_t a, int32_t b) {
+    if (!enabled.load(std::memory_order_relaxed)) return;
+    Ring& ring = local();
+    uint64_t head = ring.head.load(std::memory_order_relaxed);
+    ring.records[head & (CAPACITY - 1)] = {now(), event, static_cast<uint16_t>(ply), a, b};
+    ring.head.store(head + 1, std::memory_order_release);
+}
+
+void dump(std::ostream& out);   // Every thread's ring, oldest record first
+void installCrashHandler();     // Print the rings to stderr on SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT
+
+}
+
+#define TRACE_EVENT(event, ply, a, b) Trace::record(Trace::event, ply, a, b)
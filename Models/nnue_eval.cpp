@@ -1,8 +1,9 @@
 #include "nnue_eval.h"
+#include "log.h"
 #include <fstream>
 #include <sstream>
-#include <iostream>
 #include <cassert>
+#include <algorithm>
 
 
 NNUE::NNUE(const std::string& file) {
@@ -14,11 +15,11 @@ NNUE::NNUE(const std::string& file) {
     std::string line;
     int total_lines = 0;
 
-    auto read_matrix = [&](int rows, int cols, std::vector<std::vector<float>>& matrix) {
-        matrix.resize(rows, std::vector<float>(cols));
+    auto read_matrix = [&](int rows, int cols, std::vector<float>& matrix) {
+        matrix.resize(rows * cols);
         for (int i = 0; i < rows; ++i) {
             if (!std::getline(in, line)) {
-                std::cerr << "Unexpected EOF reading matrix row " << i << "\n";
+                LOG_ERROR("Unexpected EOF reading matrix row " << i);
                 throw std::runtime_error("Unexpected EOF");
             }
             total_lines++;
@@ -26,17 +27,17 @@ NNUE::NNUE(const std::string& file) {
             for (int j = 0; j < cols; ++j) {
                 float val;
                 if (!(ss >> val)) {
-                    std::cerr << "Parse error at matrix[" << i << "][" << j << "]\n";
+                    LOG_ERROR("Parse error at matrix[" << i << "][" << j << "]");
                     throw std::runtime_error("Bad weight value");
                 }
-                matrix[i][j] = val;
+                matrix[i * cols + j] = val;
             }
         }
     };
 
     auto read_bias = [&](int size, std::vector<float>& bias) {
         if (!std::getline(in, line)) {
-            std::cerr << "Unexpected EOF reading bias\n";
+            LOG_ERROR("Unexpected EOF reading bias");
             throw std::runtime_error("Unexpected EOF");
         }
         total_lines++;
@@ -45,7 +46,7 @@ NNUE::NNUE(const std::string& file) {
         bias.resize(size);
         for (int i = 0; i < size; ++i) {
             if (!(ss >> val)) {
-                std::cerr << "Parse error at bias[" << i << "]\n";
+                LOG_ERROR("Parse error at bias[" << i << "]");
                 throw std::runtime_error("Bad bias value");
             }
             bias[i] = val;
@@ -53,41 +54,46 @@ NNUE::NNUE(const std::string& file) {
     };
 
     // Read all layers in correct order
-    read_matrix(512, 768, weights1);
-    read_bias(512, bias1);
+    read_matrix(HIDDEN1, INPUTS, weights1);
+    read_bias(HIDDEN1, bias1);
 
-    read_matrix(256, 512, weights2);
-    read_bias(256, bias2);
+    read_matrix(HIDDEN2, HIDDEN1, weights2);
+    read_bias(HIDDEN2, bias2);
 
-    read_matrix(1, 256, weights3);
+    read_matrix(1, HIDDEN2, weights3);
     read_bias(1, bias3);
 
-    std::cout << "[DEBUG] Loaded weights successfully, total lines: " << total_lines << "\n";
+    LOG_INFO("Loaded NNUE weights from " << file << ", " << total_lines << " lines");
 }
 
-std::vector<float> NNUE::relu(const std::vector<float>& x) {
-    std::vector<float> out(x.size());
-    for (size_t i = 0; i < x.size(); ++i)
-        out[i] = std::max(0.0f, x[i]);
-    return out;
+void NNUE::relu(float* x, int size) {
+    for (int i = 0; i < size; ++i)
+        x[i] = std::max(0.0f, x[i]);
 }
 
-std::vector<float> NNUE::linear(const std::vector<float>& input,
-                                const std::vector<std::vector<float>>& weights,
-                                const std::vector<float>& bias) {
-    std::vector<float> out(bias);
-    for (size_t i = 0; i < weights.size(); ++i)
-        for (size_t j = 0; j < input.size(); ++j)
-            out[i] += weights[i][j] * input[j];
-    return out;
+void NNUE::linear(const float* input, int inputs, int outputs,
+                  const std::vector<float>& weights,
+                  const std::vector<float>& bias, float* out) {
+    for (int i = 0; i < outputs; ++i) {
+        const float* row = &weights[i * inputs];
+        float sum = bias[i];
+        for (int j = 0; j < inputs; ++j)
+            sum += row[j] * input[j];
+        out[i] = sum;
+    }
 }
 
-float NNUE::evaluate(const std::vector<float>& input) {
-    assert(input.size() == 768);
-
-    auto x1 = relu(linear(input, weights1, bias1));
-    auto x2 = relu(linear(x1, weights2, bias2));
-    auto out = linear(x2, weights3, bias3);
-    return out[0];  // Centipawn score
+float NNUE::evaluate(const float* input) const {
+    float x1[HIDDEN1], x2[HIDDEN2], out;
+    linear(input, INPUTS, HIDDEN1, weights1, bias1, x1);
+    relu(x1, HIDDEN1);
+    linear(x1, HIDDEN1, HIDDEN2, weights2, bias2, x2);
+    relu(x2, HIDDEN2);
+    linear(x2, HIDDEN2, 1, weights3, bias3, &out);
+    return out;  // Centipawn score
 }
 
+float NNUE::evaluate(const std::vector<float>& input) const {
+    assert(input.size() == INPUTS);
+    return evaluate(input.data());
+}
@@ -4,16 +4,21 @@
 
 class NNUE {
 public:
+    static constexpr int INPUTS = 768;
+    static constexpr int HIDDEN1 = 512;
+    static constexpr int HIDDEN2 = 256;
+
     NNUE(const std::string& weight_file);
-    float evaluate(const std::vector<float>& input);  // Input: 768-element vector
+    float evaluate(const float* input) const;  // Input: INPUTS floats. Works on stack buffers, no allocation
+    float evaluate(const std::vector<float>& input) const;  // Input: 768-element vector
 
 private:
-    std::vector<std::vector<float>> weights1, weights2, weights3;
+    // Flat row-major matrices: weights1[i * INPUTS + j] connects input j to neuron i
+    std::vector<float> weights1, weights2, weights3;
     std::vector<float> bias1, bias2, bias3;
 
-    std::vector<float> relu(const std::vector<float>& x);
-    std::vector<float> linear(const std::vector<float>& input,
-                              const std::vector<std::vector<float>>& weights,
-                              const std::vector<float>& bias);
+    static void relu(float* x, int size);
+    static void linear(const float* input, int inputs, int outputs,
+                       const std::vector<float>& weights,
+                       const std::vector<float>& bias, float* out);
 };
-
@@ -1,10 +1,11 @@
 #include "../../chess-library/include/chess.hpp"
-#include <vector>
+#include <algorithm>
 
 using namespace chess;
 
-std::vector<float> nnue_input_from_board(const Board& board) {
-    std::vector<float> input(768, 0.0f);
+// Fill the 768 one-hot inputs (12 piece kinds x 64 squares) into a caller-provided buffer
+void nnue_input_from_board(const Board& board, float* input) {
+    std::fill(input, input + 768, 0.0f);
 
     for (int square = 0; square < 64; ++square) {
         Piece piece = board.at(Square(square));
@@ -16,7 +17,5 @@ std::vector<float> nnue_input_from_board(const Board& board) {
         int idx = color_offset + type;  // Total index 0–11
         input[idx * 64 + square] = 1.0f;
     }
-
-    return input;
 }
 
@@ -0,0 +1,193 @@
+#include "opening_book.h"
+#include <iostream>
+#include <sstream>
+
+#ifdef DEBUG
+    #define DEBUG_PRINT(x) (std::cerr << x << std::endl)
+#else
+    #define DEBUG_PRINT(x) ((void)0)
+#endif
+
+using namespace chess;
+
+constexpr size_t MAX_CACHED_NODES = 1 << 16;
+
+// Helper: tokenize a space-delimited string into a vector of strings.
+static std::vector<std::string> tokenize(const std::string& str) {
+    std::istringstream iss(str);
+    std::vector<std::string> tokens;
+    std::string token;
+    while (iss >> token) {
+        tokens.push_back(token);
+    }
+    return tokens;
+}
+
+static const char* columnText(sqlite3_stmt* stmt, int col) {
+    const unsigned char* text = sqlite3_column_text(stmt, col);
+    return text ? reinterpret_cast<const char*>(text) : "";
+}
+
+OpeningBook::OpeningBook() {
+    prefetch_thread = std::thread(&OpeningBook::prefetchLoop, this);
+}
+
+OpeningBook::~OpeningBook() {
+    {
+        std::lock_guard<std::mutex> lock(prefetch_mutex);
+        stopping = true;
+    }
+    prefetch_cv.notify_one();
+    if (prefetch_thread.joinable())
+        prefetch_thread.join();
+
+    if (by_hash) sqlite3_finalize(by_hash);
+    if (by_fen) sqlite3_finalize(by_fen);
+    if (db) sqlite3_close(db);
+}
+
+bool OpeningBook::open(const std::string& path) {
+    std::lock_guard<std::mutex> lock(db_mutex);
+    if (db && path == db_path) return true;
+
+    if (db) {
+        if (by_hash) sqlite3_finalize(by_hash);
+        if (by_fen) sqlite3_finalize(by_fen);
+        sqlite3_close(db);
+        by_hash = by_fen = nullptr;
+        db = nullptr;
+    }
+
+    clearCache();   // Its entries came from the previous book
+
+    // The engine never writes to the book: older books are migrated by book_builder --migrate
+    sqlite3* handle = nullptr;
+    if (sqlite3_open_v2(path.c_str(), &handle, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+        DEBUG_PRINT("[DEBUG] Can't open openings database: " << sqlite3_errmsg(handle));
+        sqlite3_close(handle);
+        return false;
+    }
+    db = handle;
+    db_path = path;
+
+    const char* fen_sql = "SELECT id, fen, evaluation, moves, pv FROM nodes WHERE fen = ?;";
+    if (sqlite3_prepare_v2(db, fen_sql, -1, &by_fen, nullptr) != SQLITE_OK) {
+        DEBUG_PRINT("[DEBUG] Failed to prepare node SQL statement: " << sqlite3_errmsg(db));
+        sqlite3_close(db);
+        db = nullptr;
+        return false;
+    }
+
+    if (hasHashKeys()) {
+        const char* hash_sql = "SELECT id, fen, evaluation, moves, pv FROM nodes WHERE hash = ?;";
+        if (sqlite3_prepare_v2(db, hash_sql, -1, &by_hash, nullptr) != SQLITE_OK) {
+            DEBUG_PRINT("[DEBUG] Failed to prepare hash SQL statement: " << sqlite3_errmsg(db));
+            by_hash = nullptr;
+        }
+    }
+
+    DEBUG_PRINT("[DEBUG] Opening database opened successfully" << (by_hash ? " (hash index)" : " (FEN lookups)"));
+    return true;
+}
+
+// Whether every position has its Zobrist key in the indexed `hash` column. Rows without one
+// would silently drop out of hash lookups, so such books are looked up by FEN.
+bool OpeningBook::hasHashKeys() {
+    // The first step of a query: SQLITE_ROW if it has a result, an error if the column is missing
+    auto firstStep = [&](const char* sql) {
+        sqlite3_stmt* stmt;
+        if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) return SQLITE_ERROR;
+        int rc = sqlite3_step(stmt);
+        sqlite3_finalize(stmt);
+        return rc;
+    };
+    return firstStep("SELECT 1 FROM sqlite_master WHERE type = 'index' AND name = 'nodes_hash';") == SQLITE_ROW &&
+           firstStep("SELECT 1 FROM nodes WHERE hash IS NULL LIMIT 1;") == SQLITE_DONE;
+}
+
+// Run the prepared lookup for one position. Caller must hold db_mutex.
+OpeningNode OpeningBook::query(uint64_t key, const std::string& fen) {
+    OpeningNode node;
+    sqlite3_stmt* stmt = by_hash ? by_hash : by_fen;
+    if (!stmt) return node;
+
+    if (by_hash) sqlite3_bind_int64(stmt, 1, static_cast<sqlite3_int64>(key));
+    else sqlite3_bind_text(stmt, 1, fen.c_str(), -1, SQLITE_TRANSIENT);
+
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        node.id = sqlite3_column_int(stmt, 0);
+        node.fen = columnText(stmt, 1);
+        node.evaluation = sqlite3_column_int(stmt, 2);
+        node.moves = columnText(stmt, 3);
+        node.pv = tokenize(columnText(stmt, 4));
+    }
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    return node;
+}
+
+OpeningNode OpeningBook::probe(const Board& board) {
+    uint64_t key = board.zobrist();
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        auto it = cache.find(key);
+        if (it != cache.end()) return it->second;
+    }
+
+    OpeningNode node;
+    {
+        std::lock_guard<std::mutex> lock(db_mutex);
+        if (!db) return node;
+        node = query(key, board.getFen());
+    }
+
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    if (cache.size() >= MAX_CACHED_NODES) cache.clear();
+    cache[key] = node;
+    return node;
+}
+
+void OpeningBook::prefetchChildren(const Board& board) {
+    {
+        std::lock_guard<std::mutex> lock(prefetch_mutex);
+        prefetch_board = board;
+        prefetch_pending = true;
+    }
+    prefetch_cv.notify_one();
+}
+
+void OpeningBook::clearCache() {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    cache.clear();
+}
+
+void OpeningBook::prefetchLoop() {
+    while (true) {
+        Board board;
+        {
+            std::unique_lock<std::mutex> lock(prefetch_mutex);
+            prefetch_cv.wait(lock, [&] { return prefetch_pending || stopping; });
+            if (stopping) return;
+            board = prefetch_board;
+            prefetch_pending = false;
+        }
+
+        Movelist moves;
+        movegen::legalmoves(moves, board);
+        for (const auto& move : moves) {
+            board.makeMove(move);
+            uint64_t key = board.zobrist();
+            bool cached;
+            {
+                std::lock_guard<std::mutex> lock(cache_mutex);
+                cached = cache.count(key) > 0;
+            }
+            if (!cached) probe(board);
+            board.unmakeMove(move);
+
+            // A newer request supersedes this one
+            std::lock_guard<std::mutex> lock(prefetch_mutex);
+            if (prefetch_pending || stopping) break;
+        }
+    }
+}
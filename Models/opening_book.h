@@ -0,0 +1,64 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include <sqlite3.h>
+
+#include "../../chess-library/include/chess.hpp"
+
+// Structure to represent a node in the openings database
+struct OpeningNode {
+    int id = 0;
+    std::string fen;
+    int evaluation = 0;
+    std::string moves;  // Space-separated moves with evaluations
+    std::vector<std::string> pv;  // PV moves stored as a space-delimited string in the database
+};
+
+// Opening book service: keeps one read-only connection and its prepared statements for the
+// whole session, looks positions up by Zobrist key (indexed `hash` column) and caches results.
+// While the opponent is thinking, a background thread prefetches the positions reachable
+// by each of its replies so the next lookup is served from memory.
+class OpeningBook {
+public:
+    OpeningBook();
+    ~OpeningBook();
+
+    // Open the database once; later calls with the same path are no-ops.
+    bool open(const std::string& path);
+    bool isOpen() const { return db != nullptr; }
+
+    // Look the position up (cache first, then the database). Returns a node with an
+    // empty FEN when the position is not in the book.
+    OpeningNode probe(const chess::Board& board);
+
+    // Queue the children of `board` (one per legal move) for background lookup.
+    void prefetchChildren(const chess::Board& board);
+
+    // Forget the cached lookups (a new game, or another book).
+    void clearCache();
+
+private:
+    OpeningNode query(uint64_t key, const std::string& fen);
+    bool hasHashKeys();
+    void prefetchLoop();
+
+    sqlite3* db = nullptr;
+    std::string db_path;
+    sqlite3_stmt* by_hash = nullptr;
+    sqlite3_stmt* by_fen = nullptr;     // Fallback for books without hash keys
+    std::mutex db_mutex;                // Serializes statement use between search and prefetch
+
+    std::unordered_map<uint64_t, OpeningNode> cache;   // Misses are cached too (empty FEN)
+    std::mutex cache_mutex;
+
+    std::thread prefetch_thread;
+    std::mutex prefetch_mutex;
+    std::condition_variable prefetch_cv;
+    chess::Board prefetch_board;        // Only the most recent request is kept
+    bool prefetch_pending = false;
+    bool stopping = false;
+};
@@ -0,0 +1,120 @@
+#include "perf_counters.h"
+#include <sstream>
+#include <iomanip>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <fstream>
+#endif
+
+static const char* const EVENT_NAMES[PerfCounters::EVENT_COUNT] = {
+    "cycles", "instructions", "L1D-misses", "LLC-misses", "branch-misses"};
+
+PerfCounters::Values& PerfCounters::Values::operator+=(const Values& other) {
+    for (int e = 0; e < EVENT_COUNT; ++e) {
+        count[e] += other.count[e];
+        valid[e] = valid[e] || other.valid[e];
+    }
+    return *this;
+}
+
+std::string PerfCounters::Values::describe(uint64_t nodes) const {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1);
+    bool any = false;
+    for (int e = 0; e < EVENT_COUNT; ++e) {
+        if (!valid[e]) continue;
+        out << (any ? " " : "") << EVENT_NAMES[e] << "/node " << (nodes ? double(count[e]) / nodes : 0.0);
+        any = true;
+    }
+    if (valid[CYCLES] && valid[INSTRUCTIONS] && count[CYCLES])
+        out << " IPC " << std::setprecision(2) << double(count[INSTRUCTIONS]) / count[CYCLES];
+    if (!any) {
+        out << "hardware counters unavailable";
+#ifdef __linux__
+        std::ifstream paranoid("/proc/sys/kernel/perf_event_paranoid");
+        int level;
+        if (paranoid >> level) out << " (perf_event_paranoid = " << level << ")";
+#endif
+    }
+    return out.str();
+}
+
+#ifdef __linux__
+
+static int openEvent(uint32_t type, uint64_t config) {
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    // This thread only, on whatever CPU it runs
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+PerfCounters::PerfCounters() {
+    fds[CYCLES] = openEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    fds[INSTRUCTIONS] = openEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    fds[L1D_MISSES] = openEvent(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                                    (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+    fds[LLC_MISSES] = openEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+    fds[BRANCH_MISSES] = openEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+}
+
+PerfCounters::~PerfCounters() {
+    for (int fd : fds)
+        if (fd >= 0) close(fd);
+}
+
+bool PerfCounters::available() const {
+    for (int fd : fds)
+        if (fd >= 0) return true;
+    return false;
+}
+
+void PerfCounters::start() {
+    for (int fd : fds) {
+        if (fd < 0) continue;
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+PerfCounters::Values PerfCounters::stop() {
+    Values values;
+    for (int e = 0; e < EVENT_COUNT; ++e) {
+        if (fds[e] < 0) continue;
+        ioctl(fds[e], PERF_EVENT_IOC_DISABLE, 0);
+        uint64_t data[3];  // value, time enabled, time running
+        if (read(fds[e], data, sizeof(data)) != sizeof(data) || data[2] == 0) continue;
+        values.count[e] = data[2] < data[1] ? static_cast<uint64_t>(double(data[0]) * data[1] / data[2]) : data[0];
+        values.valid[e] = true;
+    }
+    return values;
+}
+
+#else
+
+PerfCounters::PerfCounters() {
+    for (int& fd : fds) fd = -1;
+}
+
+PerfCounters::~PerfCounters() {}
+
+bool PerfCounters::available() const {
+    return false;
+}
+
+void PerfCounters::start() {}
+
+PerfCounters::Values PerfCounters::stop() {
+    return Values();
+}
+
+#endif
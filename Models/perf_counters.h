@@ -0,0 +1,33 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// Hardware performance counters of the calling thread, through Linux perf_event_open:
+// cycles, instructions, L1 data cache and last level cache misses, branch misses.
+// Counters the kernel refuses (perf_event_paranoid, virtual machines without a PMU, other
+// systems) are simply left out, so this never stops a search from running.
+class PerfCounters {
+public:
+    enum Event { CYCLES, INSTRUCTIONS, L1D_MISSES, LLC_MISSES, BRANCH_MISSES, EVENT_COUNT };
+
+    struct Values {
+        uint64_t count[EVENT_COUNT] = {};
+        bool valid[EVENT_COUNT] = {};
+
+        Values& operator+=(const Values& other);
+        // One line with per node figures (and IPC), or why there is nothing to show
+        std::string describe(uint64_t nodes) const;
+    };
+
+    PerfCounters();     // Opens the counters for the calling thread
+    ~PerfCounters();
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool available() const;
+    void start();       // Reset and enable
+    Values stop();      // Disable and read (scaled when the kernel had to multiplex)
+
+private:
+    int fds[EVENT_COUNT];
+};
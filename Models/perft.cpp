@@ -0,0 +1,145 @@
+#include "perft.h"
+#include "hash_memory.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace chess;
+
+namespace Perft {
+
+// Lockless entry: `check` is the key xor the data, so a torn write from another thread just
+// fails verification instead of returning a wrong count.
+struct Entry {
+    std::atomic<uint64_t> check{0};
+    std::atomic<uint64_t> data{0};   // Count in the upper 56 bits, depth in the lower 8
+};
+
+// Zeroed memory is a valid empty entry, so the table lives directly in the (huge page) block
+static HashMemory memory;
+static Entry* table = nullptr;
+static uint64_t table_mask = 0;
+
+void setHashSize(size_t mb) {
+    size_t entries = 0;
+    if (mb > 0) {
+        entries = 1;
+        while (entries * 2 * sizeof(Entry) <= mb * 1024 * 1024) entries *= 2;
+    }
+    if (entries * sizeof(Entry) == memory.size()) return;
+    bool allocated = memory.resize(entries * sizeof(Entry));
+    table = allocated && entries ? static_cast<Entry*>(memory.data()) : nullptr;
+    table_mask = table ? entries - 1 : 0;
+}
+
+static bool probe(uint64_t key, int depth, uint64_t& count) {
+    Entry& e = table[key & table_mask];
+    uint64_t data = e.data.load(std::memory_order_relaxed);
+    if ((e.check.load(std::memory_order_relaxed) ^ data) != key || (data & 0xFF) != static_cast<uint64_t>(depth))
+        return false;
+    count = data >> 8;
+    return true;
+}
+
+static void store(uint64_t key, int depth, uint64_t count) {
+    Entry& e = table[key & table_mask];
+    uint64_t data = (count << 8) | static_cast<uint64_t>(depth);
+    e.check.store(key ^ data, std::memory_order_relaxed);
+    e.data.store(data, std::memory_order_relaxed);
+}
+
+static uint64_t search(Board& board, int depth) {
+    Movelist moves;
+    movegen::legalmoves(moves, board);
+    if (depth <= 1) return depth == 1 ? moves.size() : 1;
+
+    uint64_t key = board.zobrist();
+    uint64_t count = 0;
+    if (table && depth > 2 && probe(key, depth, count)) return count;
+
+    for (const auto& move : moves) {
+        board.makeMove(move);
+        count += search(board, depth - 1);
+        board.unmakeMove(move);
+    }
+
+    if (table && depth > 2) store(key, depth, count);
+    return count;
+}
+
+std::vector<std::pair<std::string, uint64_t>> divide(const Board& board, int depth, int threads) {
+    Movelist moves;
+    movegen::legalmoves(moves, board);
+    std::vector<std::pair<std::string, uint64_t>> counts(moves.size());
+
+    // Root moves are handed out one at a time, each thread works on its own copy of the board
+    std::atomic<int> next{0};
+    auto worker = [&]() {
+        Board local = board;
+        for (int i = next++; i < moves.size(); i = next++) {
+            local.makeMove(moves[i]);
+            counts[i] = {uci::moveToUci(moves[i]), depth > 1 ? search(local, depth - 1) : 1};
+            local.unmakeMove(moves[i]);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int t = 1; t < threads; ++t) workers.emplace_back(worker);
+    worker();
+    for (auto& w : workers) w.join();
+    return counts;
+}
+
+uint64_t perft(const Board& board, int depth, int threads) {
+    if (depth <= 0) return 1;
+    uint64_t total = 0;
+    for (const auto& [move, count] : divide(board, depth, threads)) total += count;
+    return total;
+}
+
+struct SuitePosition {
+    const char* name;
+    const char* fen;
+    std::vector<uint64_t> counts;   // Depth 1, 2, ...
+};
+
+static const std::vector<SuitePosition> SUITE = {
+    {"startpos", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+     {20, 400, 8902, 197281, 4865609, 119060324}},
+    {"kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+     {48, 2039, 97862, 4085603, 193690690}},
+    {"position 3", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+     {14, 191, 2812, 43238, 674624, 11030083}},
+    {"position 4", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+     {6, 264, 9467, 422333, 15833292}},
+    {"position 5", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+     {44, 1486, 62379, 2103487, 89941194}},
+    {"position 6", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+     {46, 2079, 89890, 3894594, 164075551}},
+};
+
+bool runSuite(int maxDepth, int threads, std::ostream& out) {
+    bool passed = true;
+    uint64_t nodes = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    for (const auto& position : SUITE) {
+        Board board(position.fen);
+        for (int depth = 1; depth <= maxDepth && depth <= static_cast<int>(position.counts.size()); ++depth) {
+            uint64_t count = perft(board, depth, threads);
+            bool ok = count == position.counts[depth - 1];
+            passed &= ok;
+            nodes += count;
+            out << position.name << " depth " << depth << ": " << count
+                << (ok ? " OK" : " FAILED, expected " + std::to_string(position.counts[depth - 1])) << std::endl;
+        }
+    }
+
+    long elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    out << (passed ? "All perft counts match" : "Perft MISMATCH") << " (" << nodes << " nodes, "
+        << elapsed << " ms, " << nodes * 1000 / std::max(1L, elapsed) << " nps)" << std::endl;
+    return passed;
+}
+
+}
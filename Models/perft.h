@@ -0,0 +1,25 @@
+#pragma once
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../../chess-library/include/chess.hpp"
+
+// Move generation checks and benchmarks: leaf counts of the legal move tree. The root moves
+// can be split among threads, and an optional hash table (shared by the threads, kept between
+// calls) stores the counts of subtrees already visited.
+namespace Perft {
+    // Size the perft hash table in MB; 0 disables it.
+    void setHashSize(size_t mb);
+
+    uint64_t perft(const chess::Board& board, int depth, int threads = 1);
+
+    // Leaf count below each root move, in move generation order (UCI notation).
+    std::vector<std::pair<std::string, uint64_t>> divide(const chess::Board& board, int depth, int threads = 1);
+
+    // Run the standard positions (start position, Kiwipete, ...) up to `maxDepth` and compare
+    // with the published counts. Returns true if all of them match.
+    bool runSuite(int maxDepth, int threads, std::ostream& out);
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+// Scoped hot-path profiler, only compiled with -D PROFILE (compile.py: PROFILE variant).
+// PROFILE_SCOPE(REGION) times the rest of the enclosing block with the CPU timestamp counter
+// and adds it to the calling thread's totals; Profiler::report prints cycles per call, cycles
+// per node and a log2 histogram of each region. Without PROFILE the macro expands to nothing.
+
+#ifdef PROFILE
+
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace Profiler {
+
+enum Region { SEARCH, MOVEGEN, ORDERING, EVAL, NNUE, REGION_COUNT };
+inline const char* const REGION_NAMES[REGION_COUNT] = {"search", "movegen", "ordering", "eval", "nnue"};
+
+constexpr int BUCKETS = 40;   // Bucket b holds calls of [2^b, 2^(b+1)) cycles
+
+struct RegionStats {
+    uint64_t calls = 0;
+    uint64_t cycles = 0;
+    uint64_t histogram[BUCKETS] = {};
+};
+
+struct ThreadProfile {
+    RegionStats regions[REGION_COUNT];
+};
+
+// Every thread's block stays registered (and alive) until the report
+inline std::mutex registry_mutex;
+inline std::vector<std::shared_ptr<ThreadProfile>> registry;
+
+inline ThreadProfile& local() {
+    thread_local std::shared_ptr<ThreadProfile> profile = [] {
+        auto p = std::make_shared<ThreadProfile>();
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        registry.push_back(p);
+        return p;
+    }();
+    return *profile;
+}
+
+inline uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Region region) : stats(local().regions[region]), start(now()) {}
+    ~ScopedTimer() {
+        uint64_t cycles = now() - start;
+        ++stats.calls;
+        stats.cycles += cycles;
+        int bucket = 63 - __builtin_clzll(cycles | 1);
+        ++stats.histogram[bucket < BUCKETS ? bucket : BUCKETS - 1];
+    }
+
+private:
+    RegionStats& stats;
+    uint64_t start;
+};
+
+// Sum of all threads. Regions nest (eval contains nnue, search contains everything), so the
+// shares are inclusive and do not add up to 100%.
+inline void report(std::ostream& out, uint64_t nodes) {
+    RegionStats total[REGION_COUNT];
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        for (const auto& profile : registry)
+            for (int r = 0; r < REGION_COUNT; ++r) {
+                total[r].calls += profile->regions[r].calls;
+                total[r].cycles += profile->regions[r].cycles;
+                for (int b = 0; b < BUCKETS; ++b) total[r].histogram[b] += profile->regions[r].histogram[b];
+            }
+    }
+
+    out << "Profile (" << nodes << " nodes, " << registry.size() << " threads)" << std::endl;
+    out << std::fixed << std::setprecision(1);
+    for (int r = 0; r < REGION_COUNT; ++r) {
+        const RegionStats& s = total[r];
+        if (!s.calls) continue;
+        out << "  " << std::left << std::setw(9) << REGION_NAMES[r] << std::right
+            << " calls " << std::setw(12) << s.calls
+            << "  cycles/call " << std::setw(10) << double(s.cycles) / s.calls
+            << "  cycles/node " << std::setw(10) << (nodes ? double(s.cycles) / nodes : 0.0);
+        if (total[SEARCH].cycles) out << "  (" << 100.0 * s.cycles / total[SEARCH].cycles << "% of search)";
+        out << std::endl;
+        for (int b = 0; b < BUCKETS; ++b) {
+            if (!s.histogram[b]) continue;
+            out << "      2^" << std::setw(2) << b << " cycles: " << std::setw(12) << s.histogram[b]
+                << "  " << std::setw(5) << 100.0 * s.histogram[b] / s.calls << "%" << std::endl;
+        }
+    }
+}
+
+}
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(region) Profiler::ScopedTimer PROFILE_CONCAT(profile_timer_, __LINE__)(Profiler::region)
+
+#else
+
+#define PROFILE_SCOPE(region) ((void)0)
+
+#endif
@@ -0,0 +1,150 @@
+#include "syzygy.h"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#ifdef SYZYGY
+#include "../../Fathom/src/tbprobe.h"
+#endif
+
+using namespace chess;
+
+namespace Syzygy {
+
+static std::atomic<int> probe_limit{7};
+static std::atomic<int> tables_largest{0};
+
+int largest() {
+    return std::min(tables_largest.load(std::memory_order_relaxed), probe_limit.load(std::memory_order_relaxed));
+}
+
+void setProbeLimit(int limit) {
+    probe_limit = limit;
+}
+
+#ifdef SYZYGY
+
+// tb_probe_root is not thread safe
+static std::mutex root_mutex;
+
+int init(const std::string& path) {
+    std::lock_guard<std::mutex> lock(root_mutex);
+    tables_largest = 0;
+    tb_free();
+    if (path.empty() || path == "<empty>") return 0;
+    if (!tb_init(path.c_str())) return 0;
+    tables_largest = static_cast<int>(TB_LARGEST);
+    return tables_largest;
+}
+
+// Translate the position to Fathom's arguments. Fails for positions the tables cannot answer.
+struct ProbeArgs {
+    uint64_t white, black, kings, queens, rooks, bishops, knights, pawns;
+    unsigned ep;
+    bool turn;
+};
+
+static bool toProbeArgs(const Board& board, ProbeArgs& args) {
+    if (!board.castlingRights().isEmpty()) return false;
+    uint64_t occ = board.occ().getBits();
+    if (__builtin_popcountll(occ) > largest()) return false;
+
+    args.white = board.us(Color::WHITE).getBits();
+    args.black = board.us(Color::BLACK).getBits();
+    args.kings = board.pieces(PieceType::KING).getBits();
+    args.queens = board.pieces(PieceType::QUEEN).getBits();
+    args.rooks = board.pieces(PieceType::ROOK).getBits();
+    args.bishops = board.pieces(PieceType::BISHOP).getBits();
+    args.knights = board.pieces(PieceType::KNIGHT).getBits();
+    args.pawns = board.pieces(PieceType::PAWN).getBits();
+    Square ep = board.enpassantSq();
+    args.ep = (ep == Square::NO_SQ) ? 0 : ep.index();
+    args.turn = board.sideToMove() == Color::WHITE;
+    return true;
+}
+
+// Fathom encodes WDL as 0 (loss) .. 4 (win)
+static int toWDL(unsigned result) {
+    return static_cast<int>(TB_GET_WDL(result)) - 2;
+}
+
+bool probeWDL(const Board& board, int& wdl) {
+    // WDL tables are only exact right after a zeroing move
+    if (board.halfMoveClock() != 0) return false;
+
+    ProbeArgs a;
+    if (!toProbeArgs(board, a)) return false;
+
+    unsigned result = tb_probe_wdl(a.white, a.black, a.kings, a.queens, a.rooks, a.bishops,
+                                   a.knights, a.pawns, 0, 0, a.ep, a.turn);
+    if (result == TB_RESULT_FAILED) return false;
+    wdl = toWDL(result);
+    return true;
+}
+
+bool probeRoot(const Board& board, Movelist& moves, int& wdl) {
+    moves.clear();
+    ProbeArgs a;
+    if (!toProbeArgs(board, a)) return false;
+
+    unsigned results[TB_MAX_MOVES];
+    unsigned best;
+    {
+        std::lock_guard<std::mutex> lock(root_mutex);
+        best = tb_probe_root(a.white, a.black, a.kings, a.queens, a.rooks, a.bishops, a.knights,
+                             a.pawns, board.halfMoveClock(), 0, a.ep, a.turn, results);
+    }
+    if (best == TB_RESULT_FAILED || best == TB_RESULT_CHECKMATE || best == TB_RESULT_STALEMATE)
+        return false;
+    wdl = toWDL(best);
+
+    Movelist legal;
+    movegen::legalmoves(legal, board);
+
+    // Keep the moves that preserve the best outcome, ordered by distance to zeroing
+    std::vector<std::pair<unsigned, Move>> kept;
+    for (int i = 0; results[i] != TB_RESULT_FAILED; ++i) {
+        if (toWDL(results[i]) != wdl) continue;
+        int from = TB_GET_FROM(results[i]);
+        int to = TB_GET_TO(results[i]);
+        unsigned promotes = TB_GET_PROMOTES(results[i]);
+        for (const auto& move : legal) {
+            if (move.from().index() != from || move.to().index() != to) continue;
+            if (move.typeOf() == Move::PROMOTION) {
+                static const PieceType promoted[] = {PieceType::NONE, PieceType::QUEEN, PieceType::ROOK,
+                                                     PieceType::BISHOP, PieceType::KNIGHT};
+                if (promotes == TB_PROMOTES_NONE || move.promotionType() != promoted[promotes]) continue;
+            }
+            kept.push_back({TB_GET_DTZ(results[i]), move});
+            break;
+        }
+    }
+    if (kept.empty()) return false;
+
+    // Winning: convert as fast as possible. Losing: resist as long as possible.
+    std::stable_sort(kept.begin(), kept.end(), [&](const auto& x, const auto& y) {
+        return wdl < 0 ? x.first > y.first : x.first < y.first;
+    });
+    for (const auto& [dtz, move] : kept) moves.add(move);
+    return true;
+}
+
+#else
+
+int init(const std::string&) {
+    return 0;
+}
+
+bool probeWDL(const Board&, int&) {
+    return false;
+}
+
+bool probeRoot(const Board&, Movelist& moves, int&) {
+    moves.clear();
+    return false;
+}
+
+#endif
+
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <string>
+
+#include "../../chess-library/include/chess.hpp"
+
+// Syzygy endgame tablebases, probed through Fathom (https://github.com/jdart1/Fathom).
+// Fathom is an external checkout like chess-library; compile.py builds it in and defines
+// SYZYGY when ../../Fathom is present. Without it every probe simply fails.
+namespace Syzygy {
+    // Load tables from `path` (several directories separated by ':'). An empty path or
+    // "<empty>" unloads them. Returns the largest piece count available (0 if none).
+    int init(const std::string& path);
+
+    // Largest number of pieces the loaded tables cover, capped by the SyzygyProbeLimit option.
+    int largest();
+    void setProbeLimit(int limit);
+
+    // Win/draw/loss from the side to move's point of view: 2 win, 1 cursed win (drawn by the
+    // 50 moves rule), 0 draw, -1 blessed loss, -2 loss. Only positions right after a capture or
+    // pawn move without castling rights can be probed; returns false otherwise.
+    bool probeWDL(const chess::Board& board, int& wdl);
+
+    // Root filtering: fills `moves` with the legal moves that keep the best WDL outcome, ordered
+    // by DTZ (fastest conversion when winning, slowest when losing). Returns false if the root
+    // position is not in the tables.
+    bool probeRoot(const chess::Board& board, chess::Movelist& moves, int& wdl);
+}
@@ -0,0 +1,443 @@
+// Texel tuner for the hand-crafted evaluation of Chessape_1.2 (evaluation_tables.h).
+//
+// Build:  g++ -std=c++17 -O3 -march=native -pthread -o texel_tuner texel_tuner.cpp
+// Usage:  ./texel_tuner data.csv [more files] [-t threads] [-e epochs] [-b batch] [--lr rate]
+//                       [-k K] [-o evaluation_tables.h]
+//
+// Input, one position per line:
+//   - CSV "fen,evaluation" (like NNUE/train_data.csv): white-relative centipawns, turned into
+//     an expected score with the same sigmoid as the evaluation;
+//   - CSV "fen,result": the game result from white's point of view, 1, 0.5 or 0;
+//   - EPD or FEN lines with the game result anywhere after the position ("1-0", "0-1",
+//     "1/2-1/2", e.g. c9 "1-0"; or [1.0]).
+// The header line decides between the two CSV forms; without one, numbers are centipawns.
+//
+// The evaluation is linear in the tables: every piece adds one piece-square entry of its game
+// stage, and each side adds the pawn structure entry of its pawn file mask. A position is
+// stored as its few (index, +-1) pairs plus the fixed bishop pair and rook file bonus, and the
+// tables are fitted by minimizing the mean squared error between sigmoid(K * eval) and the
+// label, with Adam over mini-batches whose gradient is split across threads. Black tables are
+// tied to the white ones (mirrored and negated), so the written tables are exactly symmetric.
+
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <fstream>
+#include <algorithm>
+#include <iomanip>
+#include <random>
+#include <cstdint>
+
+#include "../../chess-library/include/chess.hpp"
+#include "evaluation_tables.h"
+
+using namespace chess;
+using namespace std;
+using Clock = std::chrono::steady_clock;
+
+// Configuration values (overridable from the command line)
+int THREADS = max(1u, thread::hardware_concurrency());
+int EPOCHS = 20;
+int BATCH_SIZE = 16384;
+double LEARNING_RATE = 1.0;     // Adam step, in centipawns
+constexpr size_t CHUNK_LINES = 1 << 20;    // Lines parsed in parallel at a time
+
+// Weight layout: one white piece-square table per stage, then the pawn structure values
+enum Stage { EARLY, MID, END, STAGES };
+constexpr int PST_WEIGHTS = STAGES * 6 * 64;
+constexpr int PAWN_OFFSET = PST_WEIGHTS;
+constexpr int WEIGHTS = PST_WEIGHTS + 256;
+
+struct Feature {
+    uint16_t index;
+    int16_t coef;
+};
+
+// Features of sample i are features[first, first + count)
+struct Sample {
+    uint32_t first;
+    uint16_t count;
+    int16_t fixed;      // Bishop pair and rook file bonus, not tuned
+    float target;       // Expected score for white, 0 to 1
+};
+
+struct Dataset {
+    vector<Feature> features;
+    vector<Sample> samples;
+    bool centipawns = false;    // Some labels were evaluations rather than results
+
+    void append(const Dataset& other) {
+        uint32_t offset = static_cast<uint32_t>(features.size());
+        features.insert(features.end(), other.features.begin(), other.features.end());
+        for (Sample s : other.samples) {
+            s.first += offset;
+            samples.push_back(s);
+        }
+    }
+};
+
+enum class Label { CENTIPAWNS, RESULT };
+
+double sigmoid(double eval, double k) {
+    return 1.0 / (1.0 + pow(10.0, -k * eval / 400.0));
+}
+
+// Same stage rule as Chessape_1.2's evaluateBoard
+Stage stageOf(int pieceCount, int fullMoveNumber) {
+    if (pieceCount <= 12) return END;
+    if (pieceCount <= 29 || fullMoveNumber >= 6) return MID;
+    return EARLY;
+}
+
+// Same bonus as Chessape_1.2's computeExtraBonusIncremental
+int fixedBonus(const Board& board) {
+    int bonus = 0;
+    if (board.pieces(PieceType::BISHOP, Color::WHITE).count() >= 2) bonus += 25;
+    if (board.pieces(PieceType::BISHOP, Color::BLACK).count() >= 2) bonus -= 25;
+    int pawns[2][8] = {}, rooks[2][8] = {};
+    for (int color : {0, 1}) {
+        Bitboard b = board.pieces(PieceType::PAWN, Color(color));
+        while (b) ++pawns[color][b.pop() % 8];
+        b = board.pieces(PieceType::ROOK, Color(color));
+        while (b) ++rooks[color][b.pop() % 8];
+    }
+    for (int file = 0; file < 8; ++file) {
+        if (rooks[0][file] && !pawns[0][file]) bonus += rooks[0][file] * (pawns[1][file] ? 20 : 30);
+        if (rooks[1][file] && !pawns[1][file]) bonus -= rooks[1][file] * (pawns[0][file] ? 20 : 30);
+    }
+    return bonus;
+}
+
+// Result label in an EPD/FEN line, -1 if there is none
+double resultIn(const string& line) {
+    if (line.find("1/2-1/2") != string::npos || line.find("[0.5]") != string::npos) return 0.5;
+    if (line.find("1-0") != string::npos || line.find("[1.0]") != string::npos) return 1.0;
+    if (line.find("0-1") != string::npos || line.find("[0.0]") != string::npos) return 0.0;
+    return -1;
+}
+
+// The FEN at the start of the line: board, side, castling and en passant, plus the counters
+// when present
+string fenIn(const string& text) {
+    istringstream fields(text);
+    string field, fen;
+    for (int i = 0; i < 6 && fields >> field; ++i) {
+        if (i >= 4 && !all_of(field.begin(), field.end(), ::isdigit)) break;
+        fen += (i ? " " : "") + field;
+    }
+    return fen;
+}
+
+bool parseLine(const string& line, Label label, double k, Dataset& out) {
+    string fen;
+    double target;
+    size_t comma = line.rfind(',');
+    if (comma != string::npos) {
+        fen = fenIn(line.substr(0, comma));
+        char* end;
+        double value = strtod(line.c_str() + comma + 1, &end);
+        if (end == line.c_str() + comma + 1) return false;
+        target = label == Label::RESULT ? value : sigmoid(value, k);
+    }
+    else {
+        fen = fenIn(line);
+        target = resultIn(line);
+        if (target < 0) return false;
+    }
+    if (count(fen.begin(), fen.end(), '/') != 7) return false;
+
+    Board board(fen);
+    int pieceCount = board.occ().count();
+    Stage stage = stageOf(pieceCount, board.fullMoveNumber());
+    Sample sample = {static_cast<uint32_t>(out.features.size()), 0, static_cast<int16_t>(fixedBonus(board)),
+                     static_cast<float>(target)};
+    int masks[2] = {0, 0};
+    for (int color : {0, 1}) {
+        for (int type = 0; type < 6; ++type) {
+            Bitboard pieces = board.pieces(PieceType(static_cast<PieceType::underlying>(type)), Color(color));
+            while (pieces) {
+                int sq = pieces.pop();
+                int whiteSquare = color == 0 ? sq : sq ^ 56;
+                out.features.push_back({static_cast<uint16_t>((stage * 6 + type) * 64 + whiteSquare),
+                                        static_cast<int16_t>(color == 0 ? 1 : -1)});
+                if (type == 0) masks[color] |= 1 << (sq % 8);
+            }
+        }
+    }
+    if (masks[0] != masks[1]) {
+        out.features.push_back({static_cast<uint16_t>(PAWN_OFFSET + masks[0]), 1});
+        out.features.push_back({static_cast<uint16_t>(PAWN_OFFSET + masks[1]), -1});
+    }
+    sample.count = static_cast<uint16_t>(out.features.size() - sample.first);
+    out.samples.push_back(sample);
+    return true;
+}
+
+// Read every file, parsing CHUNK_LINES lines at a time on all threads
+Dataset load(const vector<string>& paths, double k) {
+    Dataset data;
+    for (const auto& path : paths) {
+        ifstream in(path);
+        if (!in) {
+            cerr << "Cannot open " << path << endl;
+            continue;
+        }
+        Label label = Label::CENTIPAWNS;
+        size_t skipped = 0;
+        vector<string> lines;
+        string line;
+        bool first = true;
+        auto flush = [&]() {
+            vector<Dataset> parts(THREADS);
+            vector<size_t> failures(THREADS, 0);
+            vector<thread> workers;
+            for (int t = 0; t < THREADS; ++t) {
+                workers.emplace_back([&, t]() {
+                    for (size_t i = t; i < lines.size(); i += THREADS)
+                        if (!parseLine(lines[i], label, k, parts[t])) ++failures[t];
+                });
+            }
+            for (auto& w : workers) w.join();
+            for (int t = 0; t < THREADS; ++t) {
+                data.append(parts[t]);
+                skipped += failures[t];
+            }
+            lines.clear();
+        };
+        while (getline(in, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (first) {
+                first = false;
+                if (line.find('/') == string::npos) {   // CSV header
+                    if (line.find("result") != string::npos || line.find("wdl") != string::npos) label = Label::RESULT;
+                    continue;
+                }
+            }
+            if (line.empty() || line[0] == '#') continue;
+            lines.push_back(line);
+            if (lines.size() == CHUNK_LINES) flush();
+        }
+        flush();
+        if (label == Label::CENTIPAWNS) data.centipawns = true;
+        if (skipped) cerr << "Skipped " << skipped << " unreadable lines in " << path << endl;
+    }
+    return data;
+}
+
+vector<double> initialWeights() {
+    const short (*tables[STAGES])[6][64] = {Evaluation::PST_early, Evaluation::PST_mid, Evaluation::PST_end};
+    vector<double> weights(WEIGHTS);
+    for (int stage = 0; stage < STAGES; ++stage)
+        for (int type = 0; type < 6; ++type)
+            for (int sq = 0; sq < 64; ++sq) weights[(stage * 6 + type) * 64 + sq] = tables[stage][0][type][sq];
+    for (int mask = 0; mask < 256; ++mask) weights[PAWN_OFFSET + mask] = Evaluation::Pawn_structure[mask];
+    return weights;
+}
+
+double evaluate(const Dataset& data, const Sample& s, const vector<double>& weights) {
+    double eval = s.fixed;
+    for (uint32_t i = s.first; i < s.first + s.count; ++i) eval += data.features[i].coef * weights[data.features[i].index];
+    return eval;
+}
+
+// Mean squared error over the whole dataset
+double loss(const Dataset& data, const vector<double>& weights, double k) {
+    vector<double> partial(THREADS, 0);
+    vector<thread> workers;
+    size_t n = data.samples.size();
+    for (int t = 0; t < THREADS; ++t) {
+        workers.emplace_back([&, t]() {
+            for (size_t i = n * t / THREADS; i < n * (t + 1) / THREADS; ++i) {
+                double error = sigmoid(evaluate(data, data.samples[i], weights), k) - data.samples[i].target;
+                partial[t] += error * error;
+            }
+        });
+    }
+    for (auto& w : workers) w.join();
+    double sum = 0;
+    for (double p : partial) sum += p;
+    return n ? sum / n : 0;
+}
+
+// K that best maps the current evaluation onto the labels (golden section search)
+double fitK(const Dataset& data, const vector<double>& weights) {
+    const double ratio = (sqrt(5.0) - 1) / 2;
+    double low = 0.05, high = 4.0;
+    double a = high - ratio * (high - low), b = low + ratio * (high - low);
+    double la = loss(data, weights, a), lb = loss(data, weights, b);
+    while (high - low > 1e-3) {
+        if (la < lb) {
+            high = b;
+            b = a;
+            lb = la;
+            a = high - ratio * (high - low);
+            la = loss(data, weights, a);
+        }
+        else {
+            low = a;
+            a = b;
+            la = lb;
+            b = low + ratio * (high - low);
+            lb = loss(data, weights, b);
+        }
+    }
+    return (low + high) / 2;
+}
+
+void tune(const Dataset& data, vector<double>& weights, double k) {
+    const double beta1 = 0.9, beta2 = 0.999, epsilon = 1e-8;
+    const double scale = k * log(10.0) / 400.0;     // d sigmoid(k e) / de = scale * s * (1 - s)
+    vector<double> m(WEIGHTS, 0), v(WEIGHTS, 0), gradient(WEIGHTS);
+    vector<vector<double>> partial(THREADS, vector<double>(WEIGHTS));
+    vector<uint32_t> order(data.samples.size());
+    for (uint32_t i = 0; i < order.size(); ++i) order[i] = i;
+    mt19937 rng(12345);
+    long step = 0;
+
+    for (int epoch = 1; epoch <= EPOCHS; ++epoch) {
+        auto start = Clock::now();
+        shuffle(order.begin(), order.end(), rng);
+        for (size_t begin = 0; begin < order.size(); begin += BATCH_SIZE) {
+            size_t end = min(order.size(), begin + BATCH_SIZE);
+            vector<thread> workers;
+            for (int t = 0; t < THREADS; ++t) {
+                workers.emplace_back([&, t]() {
+                    vector<double>& g = partial[t];
+                    fill(g.begin(), g.end(), 0.0);
+                    size_t n = end - begin;
+                    for (size_t j = begin + n * t / THREADS; j < begin + n * (t + 1) / THREADS; ++j) {
+                        const Sample& s = data.samples[order[j]];
+                        double out = sigmoid(evaluate(data, s, weights), k);
+                        double d = 2 * (out - s.target) * scale * out * (1 - out);
+                        for (uint32_t i = s.first; i < s.first + s.count; ++i)
+                            g[data.features[i].index] += d * data.features[i].coef;
+                    }
+                });
+            }
+            for (auto& w : workers) w.join();
+
+            ++step;
+            double n = static_cast<double>(end - begin);
+            double correction1 = 1 - pow(beta1, step), correction2 = 1 - pow(beta2, step);
+            for (int i = 0; i < WEIGHTS; ++i) {
+                gradient[i] = 0;
+                for (int t = 0; t < THREADS; ++t) gradient[i] += partial[t][i];
+                gradient[i] /= n;
+                m[i] = beta1 * m[i] + (1 - beta1) * gradient[i];
+                v[i] = beta2 * v[i] + (1 - beta2) * gradient[i] * gradient[i];
+                weights[i] -= LEARNING_RATE * (m[i] / correction1) / (sqrt(v[i] / correction2) + epsilon);
+            }
+        }
+        long ms = chrono::duration_cast<chrono::milliseconds>(Clock::now() - start).count();
+        cout << "Epoch " << setw(3) << epoch << ": loss " << fixed << setprecision(6) << loss(data, weights, k) << " ("
+             << ms << " ms)" << endl;
+    }
+}
+
+// evaluation_tables.h with the tuned values; black tables are the mirrored white ones
+void writeTables(const string& path, const vector<double>& weights, size_t positions, double k, double finalLoss) {
+    static const char* const STAGE_NAMES[STAGES] = {"PST_early", "PST_mid", "PST_end"};
+    static const char* const PIECE_NAMES[6] = {"Pawn", "Knight", "Bishop", "Rook", "Queen", "King"};
+    auto value = [&](int index) { return static_cast<int>(lround(weights[index])); };
+
+    ofstream out(path);
+    out << "#pragma once\n\n"
+        << "// Hand-crafted evaluation tables of Chessape_1.2: one piece-square table per game stage, with\n"
+        << "// the material value folded in, and the pawn structure penalty indexed by the 8-bit mask of\n"
+        << "// files that hold pawns. Tables are [color][piece][square]; black values are negative.\n"
+        << "// Generated by texel_tuner from " << positions << " positions (K " << fixed << setprecision(3) << k
+        << ", loss " << setprecision(6) << finalLoss << ").\n\n"
+        << "namespace Evaluation {\n";
+    for (int stage = 0; stage < STAGES; ++stage) {
+        out << "    constexpr short " << STAGE_NAMES[stage] << "[2][6][64] = {\n";
+        for (int color = 0; color < 2; ++color) {
+            out << "        { // " << (color == 0 ? "White" : "Black") << " tables\n";
+            for (int type = 0; type < 6; ++type) {
+                out << "            {   // " << PIECE_NAMES[type] << " table\n";
+                for (int rank = 0; rank < 8; ++rank) {
+                    out << "               ";
+                    for (int file = 0; file < 8; ++file) {
+                        int sq = rank * 8 + file;
+                        int v = color == 0 ? value((stage * 6 + type) * 64 + sq) : -value((stage * 6 + type) * 64 + (sq ^ 56));
+                        out << " " << setw(4) << v << (rank == 7 && file == 7 ? "" : ",");
+                    }
+                    out << "\n";
+                }
+                out << "            }" << (type < 5 ? "," : "") << "\n";
+            }
+            out << "        }" << (color == 0 ? "," : "") << "\n";
+        }
+        out << "    };\n";
+    }
+    out << "\n    constexpr short Pawn_structure[256] = {\n";
+    for (int row = 0; row < 16; ++row) {
+        out << "      ";
+        for (int col = 0; col < 16; ++col) {
+            int mask = row * 16 + col;
+            out << setw(4) << value(PAWN_OFFSET + mask) << (mask == 255 ? "" : ",");
+        }
+        out << "\n";
+    }
+    out << "    };\n}\n";
+}
+
+int main(int argc, char* argv[]) {
+    vector<string> paths;
+    string outputPath = "evaluation_tables.h";
+    double k = 0;   // Fitted when not given
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if ((arg == "-t" || arg == "--threads") && i + 1 < argc) THREADS = max(1, stoi(argv[++i]));
+        else if ((arg == "-e" || arg == "--epochs") && i + 1 < argc) EPOCHS = max(0, stoi(argv[++i]));
+        else if ((arg == "-b" || arg == "--batch") && i + 1 < argc) BATCH_SIZE = max(1, stoi(argv[++i]));
+        else if (arg == "--lr" && i + 1 < argc) LEARNING_RATE = stod(argv[++i]);
+        else if (arg == "-k" && i + 1 < argc) k = stod(argv[++i]);
+        else if (arg == "-o" && i + 1 < argc) outputPath = argv[++i];
+        else if (!arg.empty() && arg[0] == '-') {
+            cerr << "Unknown argument " << arg << endl;
+            return 1;
+        }
+        else paths.push_back(arg);
+    }
+    if (paths.empty()) {
+        cerr << "Usage: " << argv[0] << " data.csv [more files] [-t threads] [-e epochs] [-b batch] [--lr rate]"
+             << " [-k K] [-o evaluation_tables.h]" << endl;
+        return 1;
+    }
+
+    // Centipawn labels go through the sigmoid as they are read, with K = 1 unless given; K is
+    // only fitted when every label is a result, since evaluations already share the eval's scale
+    auto start = Clock::now();
+    Dataset data = load(paths, k > 0 ? k : 1.0);
+    if (data.samples.empty()) {
+        cerr << "No positions loaded" << endl;
+        return 1;
+    }
+    long ms = chrono::duration_cast<chrono::milliseconds>(Clock::now() - start).count();
+    cout << "Loaded " << data.samples.size() << " positions, " << data.features.size() << " features ("
+         << (data.samples.size() * sizeof(Sample) + data.features.size() * sizeof(Feature)) / (1 << 20) << " MB) in "
+         << ms << " ms on " << THREADS << " threads" << endl;
+
+    vector<double> weights = initialWeights();
+    if (k <= 0 && data.centipawns) k = 1.0;
+    else if (k <= 0) {
+        k = fitK(data, weights);
+        cout << "Fitted K " << fixed << setprecision(3) << k << endl;
+    }
+    cout << "Initial loss " << fixed << setprecision(6) << loss(data, weights, k) << endl;
+
+    start = Clock::now();
+    tune(data, weights, k);
+    double finalLoss = loss(data, weights, k);
+    long seconds = chrono::duration_cast<chrono::seconds>(Clock::now() - start).count();
+
+    writeTables(outputPath, weights, data.samples.size(), k, finalLoss);
+    cout << "Final loss " << setprecision(6) << finalLoss << " after " << seconds << " s, tables written to "
+         << outputPath << endl;
+    return 0;
+}
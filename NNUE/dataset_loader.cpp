@@ -0,0 +1,243 @@
+// Streaming loader for PackedPosition files (see packed_position.h), built as a shared library
+// with a C ABI for dataset_loader.py.
+//
+// Build:  g++ -std=c++17 -O3 -march=native -shared -fPIC -pthread -o libdataset_loader.so dataset_loader.cpp
+//
+// The file is memory-mapped, so datasets larger than RAM work: pages are read as the workers
+// touch them and dropped by the kernel under pressure. Each epoch the file is cut into blocks
+// of BLOCK_RECORDS, the block order is shuffled, and worker threads take blocks, shuffle the
+// records within them and decode them into batches of sparse features (COO rows and columns
+// into the 768 inputs, with their values) plus scores and results. Finished batches wait in a
+// bounded queue, so decoding runs ahead of the training loop without unbounded memory.
+// Records with mate or tablebase scores are skipped, so a batch may be smaller than asked.
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "packed_position.h"
+
+constexpr size_t BLOCK_RECORDS = 1 << 16;   // 2 MB of records, the unit of shuffling across the file
+constexpr int MAX_FEATURES = 32;
+
+extern "C" {
+
+// Buffers stay valid until the next dataset_next or dataset_close
+struct DatasetBatch {
+    int32_t size;       // Positions
+    int32_t nnz;        // Active features, MAX_FEATURES at most per position
+    int32_t* rows;      // Position of each feature, 0 to size - 1
+    int32_t* cols;      // Input index of each feature: piece code * 64 + square
+    float* values;      // 1 for every feature
+    float* scores;      // Search score, white's point of view, centipawns
+    float* results;     // Game result for white: 1, 0.5 or 0
+};
+
+}
+
+namespace {
+
+struct Buffer {
+    DatasetBatch batch;
+    std::vector<int32_t> rows, cols;
+    std::vector<float> values, scores, results;
+
+    explicit Buffer(int capacity)
+        : rows(capacity * MAX_FEATURES), cols(capacity * MAX_FEATURES), values(capacity * MAX_FEATURES, 1.0f),
+          scores(capacity), results(capacity) {
+        batch = {0, 0, rows.data(), cols.data(), values.data(), scores.data(), results.data()};
+    }
+};
+
+class Loader {
+public:
+    Loader(const PackedPosition* records, size_t count, size_t mappedBytes, int batchSize, int threads, bool shuffle, uint64_t seed)
+        : records(records), count(count), mappedBytes(mappedBytes), batchSize(batchSize), threads(threads),
+          shuffle(shuffle), rng(seed) {
+        // Enough buffers for every worker to fill one while the queue holds one each
+        for (int i = 0; i < 2 * threads + 1; ++i) {
+            buffers.emplace_back(new Buffer(batchSize));
+            free.push_back(buffers.back().get());
+        }
+        startEpoch();
+    }
+
+    ~Loader() {
+        stopWorkers();
+        munmap(const_cast<PackedPosition*>(records), mappedBytes);
+    }
+
+    size_t size() const { return count; }
+
+    // Next batch, or nullptr at the end of an epoch; the next epoch is already being decoded
+    // by then, and the call after returns its first batch
+    DatasetBatch* next() {
+        std::unique_lock<std::mutex> lock(queue_mutex);
+        if (current) {
+            free.push_back(current);
+            current = nullptr;
+            queue_cv.notify_all();
+        }
+        queue_cv.wait(lock, [&] { return !ready.empty() || runningWorkers == 0; });
+        if (ready.empty()) {    // Workers finished with nothing left: the epoch is over
+            lock.unlock();
+            stopWorkers();
+            startEpoch();
+            return nullptr;
+        }
+        current = ready.front();
+        ready.pop_front();
+        queue_cv.notify_all();
+        return &current->batch;
+    }
+
+private:
+    const PackedPosition* records;
+    size_t count, mappedBytes;
+    int batchSize, threads;
+    bool shuffle;
+    std::mt19937_64 rng;
+
+    std::vector<std::unique_ptr<Buffer>> buffers;
+    std::deque<Buffer*> free, ready;
+    Buffer* current = nullptr;
+    std::mutex queue_mutex;
+    std::condition_variable queue_cv;
+    int runningWorkers = 0;
+    std::atomic<bool> stopping{false};
+
+    std::vector<size_t> blocks;
+    std::atomic<size_t> nextBlock{0};
+    std::vector<std::thread> workers;
+
+    void startEpoch() {
+        blocks.resize((count + BLOCK_RECORDS - 1) / BLOCK_RECORDS);
+        std::iota(blocks.begin(), blocks.end(), 0);
+        if (shuffle) std::shuffle(blocks.begin(), blocks.end(), rng);
+        nextBlock = 0;
+        stopping = false;
+        runningWorkers = threads;
+        for (int t = 0; t < threads; ++t) workers.emplace_back(&Loader::work, this, rng());
+    }
+
+    void stopWorkers() {
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            stopping = true;
+            queue_cv.notify_all();
+        }
+        for (auto& w : workers) w.join();
+        workers.clear();
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        for (Buffer* b : ready) free.push_back(b);
+        ready.clear();
+    }
+
+    Buffer* takeFree() {
+        std::unique_lock<std::mutex> lock(queue_mutex);
+        queue_cv.wait(lock, [&] { return !free.empty() || stopping; });
+        if (stopping) return nullptr;
+        Buffer* b = free.front();
+        free.pop_front();
+        return b;
+    }
+
+    void publish(Buffer* b) {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        ready.push_back(b);
+        queue_cv.notify_all();
+    }
+
+    void work(uint64_t seed) {
+        std::mt19937_64 random(seed);
+        std::vector<uint32_t> order;
+        Buffer* b = nullptr;
+        auto flush = [&]() {
+            if (b && b->batch.size) publish(b);
+            else if (b) {
+                std::lock_guard<std::mutex> lock(queue_mutex);
+                free.push_back(b);
+            }
+            b = nullptr;
+        };
+
+        for (size_t i = nextBlock++; i < blocks.size(); i = nextBlock++) {
+            size_t first = blocks[i] * BLOCK_RECORDS, n = std::min(BLOCK_RECORDS, count - first);
+            order.resize(n);
+            std::iota(order.begin(), order.end(), 0);
+            if (shuffle) std::shuffle(order.begin(), order.end(), random);
+            for (uint32_t k : order) {
+                const PackedPosition& record = records[first + k];
+                if (record.score >= 29000 || record.score <= -29000) continue;
+                if (!b) {
+                    if (!(b = takeFree())) break;
+                    b->batch.size = b->batch.nnz = 0;
+                }
+                DatasetBatch& batch = b->batch;
+                int32_t row = batch.size++;
+                record.forEachPiece([&](int square, int code) {
+                    batch.rows[batch.nnz] = row;
+                    batch.cols[batch.nnz] = code * 64 + square;
+                    ++batch.nnz;
+                });
+                batch.scores[row] = record.score;
+                batch.results[row] = (record.result + 1) / 2.0f;
+                if (batch.size == batchSize) flush();
+            }
+            if (stopping) break;
+        }
+        flush();
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        --runningWorkers;
+        queue_cv.notify_all();
+    }
+};
+
+}
+
+extern "C" {
+
+// NULL if the file cannot be mapped or holds no whole record
+void* dataset_open(const char* path, int batch_size, int threads, int shuffle, uint64_t seed) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return nullptr;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(PackedPosition))) {
+        close(fd);
+        return nullptr;
+    }
+    size_t bytes = static_cast<size_t>(info.st_size);
+    void* data = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return nullptr;
+    madvise(data, bytes, shuffle ? MADV_RANDOM : MADV_SEQUENTIAL);
+    return new Loader(static_cast<const PackedPosition*>(data), bytes / sizeof(PackedPosition), bytes,
+                      std::max(1, batch_size), std::max(1, threads), shuffle != 0, seed);
+}
+
+int64_t dataset_size(void* loader) {
+    return static_cast<int64_t>(static_cast<Loader*>(loader)->size());
+}
+
+DatasetBatch* dataset_next(void* loader) {
+    return static_cast<Loader*>(loader)->next();
+}
+
+void dataset_close(void* loader) {
+    delete static_cast<Loader*>(loader);
+}
+
+}
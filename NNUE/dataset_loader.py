@@ -0,0 +1,78 @@
+import ctypes
+import os
+
+import numpy as np
+import torch
+
+# ctypes wrapper of libdataset_loader.so (dataset_loader.cpp): batches of sparse inputs decoded
+# from a memory-mapped PackedPosition file on native threads.
+
+class _Batch(ctypes.Structure):
+    _fields_ = [
+        ("size", ctypes.c_int32),
+        ("nnz", ctypes.c_int32),
+        ("rows", ctypes.POINTER(ctypes.c_int32)),
+        ("cols", ctypes.POINTER(ctypes.c_int32)),
+        ("values", ctypes.POINTER(ctypes.c_float)),
+        ("scores", ctypes.POINTER(ctypes.c_float)),
+        ("results", ctypes.POINTER(ctypes.c_float)),
+    ]
+
+def _load_library(path=None):
+    lib = ctypes.CDLL(path or os.path.join(os.path.dirname(os.path.abspath(__file__)), "libdataset_loader.so"))
+    lib.dataset_open.restype = ctypes.c_void_p
+    lib.dataset_open.argtypes = [ctypes.c_char_p, ctypes.c_int, ctypes.c_int, ctypes.c_int, ctypes.c_uint64]
+    lib.dataset_size.restype = ctypes.c_int64
+    lib.dataset_size.argtypes = [ctypes.c_void_p]
+    lib.dataset_next.restype = ctypes.POINTER(_Batch)
+    lib.dataset_next.argtypes = [ctypes.c_void_p]
+    lib.dataset_close.restype = None
+    lib.dataset_close.argtypes = [ctypes.c_void_p]
+    return lib
+
+class BinaryDataset:
+    """Iterates over one epoch of a PackedPosition file per `for` loop.
+
+    Each batch is (indices, values, scores, results): indices is a 2 x nnz LongTensor of
+    (position, input) pairs and values their 1.0s, ready for torch.sparse_coo_tensor or
+    index_put_; scores (centipawns) and results (1, 0.5, 0) are from white's point of view.
+    """
+
+    def __init__(self, path, batch_size=4096, threads=None, shuffle=True, seed=0, library=None):
+        self._lib = _load_library(library)
+        self._handle = self._lib.dataset_open(path.encode(), batch_size, threads or os.cpu_count() or 1,
+                                              1 if shuffle else 0, seed)
+        if not self._handle:
+            raise OSError(f"Cannot map dataset {path}")
+
+    def __len__(self):
+        return self._lib.dataset_size(self._handle)
+
+    def __iter__(self):
+        while True:
+            batch = self._lib.dataset_next(self._handle)
+            if not batch:
+                return
+            b = batch.contents
+            # The native buffers are reused by the next call, so copy them out
+            rows = np.ctypeslib.as_array(b.rows, shape=(b.nnz,))
+            cols = np.ctypeslib.as_array(b.cols, shape=(b.nnz,))
+            indices = torch.from_numpy(np.stack([rows, cols]).astype(np.int64))
+            values = torch.from_numpy(np.ctypeslib.as_array(b.values, shape=(b.nnz,)).copy())
+            scores = torch.from_numpy(np.ctypeslib.as_array(b.scores, shape=(b.size,)).copy())
+            results = torch.from_numpy(np.ctypeslib.as_array(b.results, shape=(b.size,)).copy())
+            yield indices, values, scores, results
+
+    def close(self):
+        if self._handle:
+            self._lib.dataset_close(self._handle)
+            self._handle = None
+
+    def __del__(self):
+        self.close()
+
+def dense_inputs(indices, values, size, inputs=768):
+    """The batch as a dense size x inputs tensor, for models that take dense input."""
+    x = torch.zeros(size, inputs)
+    x.index_put_((indices[0], indices[1]), values)
+    return x
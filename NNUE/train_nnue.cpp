@@ -0,0 +1,350 @@
+// Native trainer for the engine's 768-512-256-1 network, reading the packed records written
+// by the engine's datagen command and writing weights.txt in the format Models/nnue_eval.cpp
+// loads.
+//
+// Build:  g++ -std=c++17 -O3 -march=native -ffast-math -pthread -o train_nnue train_nnue.cpp
+// Usage:  ./train_nnue data.bin [more files] [-e epochs] [-b batch] [--lr rate] [-t threads]
+//                      [--lambda L] [--scale S] [--init weights.txt] [-o weights.txt] [--seed N]
+//
+// Only ~32 of the 768 inputs are set, so the first layer keeps its weights transposed (one row
+// of 512 per input) and both its forward and backward passes touch just the active rows. The
+// dense layers run as contiguous multiply-adds over the hidden vectors, which the compiler
+// turns into SIMD with -march=native, and skip inputs that the ReLU zeroed. A batch is split
+// across threads, each with its own gradients, which are then summed in parallel. Data is
+// streamed from disk CHUNK_RECORDS at a time and shuffled within each chunk, so datasets need
+// not fit in memory.
+//
+// The loss is the squared error in win probability space, sigmoid(out / scale) against
+// lambda * sigmoid(score / scale) + (1 - lambda) * result, with the optimizer and the PyTorch
+// default initialization of train_nnue.py (Adam, uniform +-1/sqrt(fan in)). The network still
+// outputs centipawns from white's point of view, as the engine expects. Weights are written
+// after every epoch.
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <fstream>
+#include <algorithm>
+#include <iomanip>
+#include <random>
+#include <cstdio>
+
+#include "packed_position.h"
+
+using namespace std;
+using Clock = std::chrono::steady_clock;
+
+constexpr int INPUTS = 768, HIDDEN1 = 512, HIDDEN2 = 256;
+constexpr size_t CHUNK_RECORDS = 1 << 20;   // 32 MB of records in memory at a time
+
+// Configuration values (overridable from the command line)
+int EPOCHS = 10;
+int BATCH_SIZE = 4096;
+int THREADS = max(1u, thread::hardware_concurrency());
+double LEARNING_RATE = 1e-3;
+double LAMBDA = 1.0;        // Weight of the search score against the game result
+double SCALE = 400.0;       // Centipawns per unit of the sigmoid's argument
+
+// Every parameter in one flat vector, so the optimizer and the gradient sums are single loops
+struct Network {
+    static constexpr size_t W1 = 0;                           // [INPUTS][HIDDEN1], transposed
+    static constexpr size_t B1 = W1 + INPUTS * HIDDEN1;
+    static constexpr size_t W2 = B1 + HIDDEN1;                // [HIDDEN1][HIDDEN2], transposed
+    static constexpr size_t B2 = W2 + HIDDEN1 * HIDDEN2;
+    static constexpr size_t W3 = B2 + HIDDEN2;
+    static constexpr size_t B3 = W3 + HIDDEN2;
+    static constexpr size_t SIZE = B3 + 1;
+
+    vector<float> p = vector<float>(SIZE, 0.0f);
+
+    float* w1(int input) { return &p[W1 + static_cast<size_t>(input) * HIDDEN1]; }
+    float* w2(int input) { return &p[W2 + static_cast<size_t>(input) * HIDDEN2]; }
+};
+
+struct Sample {
+    uint16_t inputs[32];
+    uint8_t count;
+    float target;       // Expected score for white, 0 to 1
+};
+
+double sigmoid(double x) {
+    return 1.0 / (1.0 + exp(-x));
+}
+
+bool toSample(const PackedPosition& record, Sample& sample) {
+    if (abs(record.score) >= 29000) return false;   // Mates and tablebase wins carry no eval
+    sample.count = 0;
+    record.forEachPiece([&](int square, int code) {
+        if (sample.count < 32) sample.inputs[sample.count++] = static_cast<uint16_t>(code * 64 + square);
+    });
+    sample.target = static_cast<float>(LAMBDA * sigmoid(record.score / SCALE) + (1 - LAMBDA) * (record.result + 1) / 2.0);
+    return true;
+}
+
+// Gradients and activations of one thread
+struct Worker {
+    Network gradient;
+    float h1[HIDDEN1], h2[HIDDEN2], d1[HIDDEN1], d2[HIDDEN2];
+    double loss = 0;
+};
+
+// Forward and backward pass of one sample, adding into w.gradient; returns the loss
+double trainSample(Network& net, const Sample& s, Worker& w) {
+    float* h1 = w.h1;
+    float* h2 = w.h2;
+    copy(&net.p[Network::B1], &net.p[Network::B1] + HIDDEN1, h1);
+    for (int k = 0; k < s.count; ++k) {
+        const float* row = net.w1(s.inputs[k]);
+        for (int i = 0; i < HIDDEN1; ++i) h1[i] += row[i];
+    }
+    for (int i = 0; i < HIDDEN1; ++i) h1[i] = max(0.0f, h1[i]);
+
+    copy(&net.p[Network::B2], &net.p[Network::B2] + HIDDEN2, h2);
+    for (int j = 0; j < HIDDEN1; ++j) {
+        if (h1[j] == 0.0f) continue;
+        const float a = h1[j];
+        const float* row = net.w2(j);
+        for (int i = 0; i < HIDDEN2; ++i) h2[i] += a * row[i];
+    }
+    for (int i = 0; i < HIDDEN2; ++i) h2[i] = max(0.0f, h2[i]);
+
+    const float* w3 = &net.p[Network::W3];
+    float out = net.p[Network::B3];
+    for (int i = 0; i < HIDDEN2; ++i) out += w3[i] * h2[i];
+
+    double prediction = sigmoid(out / SCALE);
+    double error = prediction - s.target;
+    float dOut = static_cast<float>(2 * error * prediction * (1 - prediction) / SCALE);
+
+    // Output layer
+    float* g = w.gradient.p.data();
+    for (int i = 0; i < HIDDEN2; ++i) {
+        g[Network::W3 + i] += dOut * h2[i];
+        w.d2[i] = h2[i] > 0.0f ? dOut * w3[i] : 0.0f;
+    }
+    g[Network::B3] += dOut;
+
+    // Second layer: only inputs the ReLU let through have gradients to pass on
+    float* d2 = w.d2;
+    for (int i = 0; i < HIDDEN2; ++i) g[Network::B2 + i] += d2[i];
+    for (int j = 0; j < HIDDEN1; ++j) {
+        if (h1[j] == 0.0f) {
+            w.d1[j] = 0.0f;
+            continue;
+        }
+        const float a = h1[j];
+        const float* row = net.w2(j);
+        float* gradRow = w.gradient.w2(j);
+        float sum = 0.0f;
+        for (int i = 0; i < HIDDEN2; ++i) {
+            gradRow[i] += a * d2[i];
+            sum += row[i] * d2[i];
+        }
+        w.d1[j] = sum;
+    }
+
+    // First layer: the active rows only
+    float* d1 = w.d1;
+    for (int i = 0; i < HIDDEN1; ++i) g[Network::B1 + i] += d1[i];
+    for (int k = 0; k < s.count; ++k) {
+        float* gradRow = w.gradient.w1(s.inputs[k]);
+        for (int i = 0; i < HIDDEN1; ++i) gradRow[i] += d1[i];
+    }
+    return error * error;
+}
+
+class Adam {
+public:
+    explicit Adam(size_t size) : m(size, 0.0f), v(size, 0.0f) {}
+
+    // Parameters [begin, end) of one step; steps are counted by the caller
+    void update(Network& net, const vector<float>& gradient, size_t begin, size_t end, long step) {
+        const float beta1 = 0.9f, beta2 = 0.999f, epsilon = 1e-8f;
+        float rate = static_cast<float>(LEARNING_RATE * sqrt(1 - pow(beta2, step)) / (1 - pow(beta1, step)));
+        for (size_t i = begin; i < end; ++i) {
+            m[i] = beta1 * m[i] + (1 - beta1) * gradient[i];
+            v[i] = beta2 * v[i] + (1 - beta2) * gradient[i] * gradient[i];
+            net.p[i] -= rate * m[i] / (sqrt(v[i]) + epsilon);
+        }
+    }
+
+private:
+    vector<float> m, v;
+};
+
+// One batch: samples split across threads, then gradients summed and applied, each thread
+// taking a slice of the parameters
+double trainBatch(Network& net, Adam& adam, const Sample* batch, size_t n, vector<Worker>& workers, long step) {
+    vector<thread> threads;
+    for (int t = 0; t < THREADS; ++t) {
+        threads.emplace_back([&, t]() {
+            Worker& w = workers[t];
+            fill(w.gradient.p.begin(), w.gradient.p.end(), 0.0f);
+            w.loss = 0;
+            for (size_t i = n * t / THREADS; i < n * (t + 1) / THREADS; ++i) w.loss += trainSample(net, batch[i], w);
+        });
+    }
+    for (auto& th : threads) th.join();
+    threads.clear();
+
+    vector<float>& total = workers[0].gradient.p;
+    for (int t = 0; t < THREADS; ++t) {
+        threads.emplace_back([&, t]() {
+            size_t begin = Network::SIZE * t / THREADS, end = Network::SIZE * (t + 1) / THREADS;
+            float scale = 1.0f / n;
+            for (size_t i = begin; i < end; ++i) {
+                float sum = total[i];
+                for (int other = 1; other < THREADS; ++other) sum += workers[other].gradient.p[i];
+                total[i] = sum * scale;
+            }
+            adam.update(net, total, begin, end, step);
+        });
+    }
+    for (auto& th : threads) th.join();
+
+    double loss = 0;
+    for (const auto& w : workers) loss += w.loss;
+    return loss;
+}
+
+// PyTorch's nn.Linear default: weights and biases uniform in +-1/sqrt(fan in)
+void initialize(Network& net, unsigned seed) {
+    mt19937 rng(seed);
+    auto fill = [&](size_t begin, size_t count, int fanIn) {
+        uniform_real_distribution<float> dist(-1.0f / sqrt(fanIn), 1.0f / sqrt(fanIn));
+        for (size_t i = begin; i < begin + count; ++i) net.p[i] = dist(rng);
+    };
+    fill(Network::W1, INPUTS * HIDDEN1 + HIDDEN1, INPUTS);
+    fill(Network::W2, HIDDEN1 * HIDDEN2 + HIDDEN2, HIDDEN1);
+    fill(Network::W3, HIDDEN2 + 1, HIDDEN2);
+}
+
+// Engine format: each layer as one line per output neuron holding its input weights, then one
+// line with the biases
+bool readWeights(const string& path, Network& net) {
+    ifstream in(path);
+    auto weights = [&](size_t base, int rows, int cols) {
+        for (int i = 0; i < rows; ++i)
+            for (int j = 0; j < cols; ++j) in >> net.p[base + static_cast<size_t>(j) * rows + i];
+    };
+    auto biases = [&](size_t base, int size) {
+        for (int i = 0; i < size; ++i) in >> net.p[base + i];
+    };
+    weights(Network::W1, HIDDEN1, INPUTS);
+    biases(Network::B1, HIDDEN1);
+    weights(Network::W2, HIDDEN2, HIDDEN1);
+    biases(Network::B2, HIDDEN2);
+    weights(Network::W3, 1, HIDDEN2);
+    biases(Network::B3, 1);
+    return static_cast<bool>(in);
+}
+
+void writeWeights(const string& path, const Network& net) {
+    string temporary = path + ".tmp";
+    FILE* out = fopen(temporary.c_str(), "w");
+    if (!out) {
+        cerr << "Cannot write " << temporary << endl;
+        return;
+    }
+    auto weights = [&](size_t base, int rows, int cols) {
+        for (int i = 0; i < rows; ++i)
+            for (int j = 0; j < cols; ++j) fprintf(out, j + 1 < cols ? "%.9g " : "%.9g\n", net.p[base + static_cast<size_t>(j) * rows + i]);
+    };
+    auto biases = [&](size_t base, int size) {
+        for (int i = 0; i < size; ++i) fprintf(out, i + 1 < size ? "%.9g " : "%.9g\n", net.p[base + i]);
+    };
+    weights(Network::W1, HIDDEN1, INPUTS);
+    biases(Network::B1, HIDDEN1);
+    weights(Network::W2, HIDDEN2, HIDDEN1);
+    biases(Network::B2, HIDDEN2);
+    weights(Network::W3, 1, HIDDEN2);
+    biases(Network::B3, 1);
+    fclose(out);
+    rename(temporary.c_str(), path.c_str());   // An interrupted write never leaves half a file
+}
+
+int main(int argc, char* argv[]) {
+    vector<string> paths;
+    string initPath, outputPath = "weights.txt";
+    unsigned seed = 12345;
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if ((arg == "-e" || arg == "--epochs") && i + 1 < argc) EPOCHS = max(1, stoi(argv[++i]));
+        else if ((arg == "-b" || arg == "--batch") && i + 1 < argc) BATCH_SIZE = max(1, stoi(argv[++i]));
+        else if (arg == "--lr" && i + 1 < argc) LEARNING_RATE = stod(argv[++i]);
+        else if ((arg == "-t" || arg == "--threads") && i + 1 < argc) THREADS = max(1, stoi(argv[++i]));
+        else if (arg == "--lambda" && i + 1 < argc) LAMBDA = stod(argv[++i]);
+        else if (arg == "--scale" && i + 1 < argc) SCALE = stod(argv[++i]);
+        else if (arg == "--init" && i + 1 < argc) initPath = argv[++i];
+        else if (arg == "-o" && i + 1 < argc) outputPath = argv[++i];
+        else if (arg == "--seed" && i + 1 < argc) seed = static_cast<unsigned>(stoul(argv[++i]));
+        else if (!arg.empty() && arg[0] == '-') {
+            cerr << "Unknown argument " << arg << endl;
+            return 1;
+        }
+        else paths.push_back(arg);
+    }
+    if (paths.empty()) {
+        cerr << "Usage: " << argv[0] << " data.bin [more files] [-e epochs] [-b batch] [--lr rate] [-t threads]"
+             << " [--lambda L] [--scale S] [--init weights.txt] [-o weights.txt] [--seed N]" << endl;
+        return 1;
+    }
+
+    Network net;
+    if (initPath.empty()) initialize(net, seed);
+    else if (!readWeights(initPath, net)) {
+        cerr << "Could not read weights from " << initPath << endl;
+        return 1;
+    }
+    Adam adam(Network::SIZE);
+    vector<Worker> workers(THREADS);
+    mt19937 rng(seed);
+    long step = 0;
+
+    cout << "Training 768-" << HIDDEN1 << "-" << HIDDEN2 << "-1 on " << paths.size() << " files: batch " << BATCH_SIZE
+         << ", lr " << LEARNING_RATE << ", lambda " << LAMBDA << ", scale " << SCALE << ", " << THREADS << " threads" << endl;
+
+    vector<PackedPosition> records(CHUNK_RECORDS);
+    vector<Sample> samples;
+    samples.reserve(CHUNK_RECORDS);
+    for (int epoch = 1; epoch <= EPOCHS; ++epoch) {
+        auto start = Clock::now();
+        double loss = 0;
+        size_t seen = 0;
+        for (const auto& path : paths) {
+            ifstream in(path, ios::binary);
+            if (!in) {
+                cerr << "Cannot open " << path << endl;
+                continue;
+            }
+            while (in) {
+                in.read(reinterpret_cast<char*>(records.data()), CHUNK_RECORDS * sizeof(PackedPosition));
+                size_t count = in.gcount() / sizeof(PackedPosition);
+                samples.clear();
+                Sample sample;
+                for (size_t i = 0; i < count; ++i)
+                    if (toSample(records[i], sample)) samples.push_back(sample);
+                shuffle(samples.begin(), samples.end(), rng);
+                for (size_t begin = 0; begin < samples.size(); begin += BATCH_SIZE) {
+                    size_t n = min<size_t>(BATCH_SIZE, samples.size() - begin);
+                    loss += trainBatch(net, adam, &samples[begin], n, workers, ++step);
+                    seen += n;
+                }
+            }
+        }
+        if (!seen) {
+            cerr << "No training positions" << endl;
+            return 1;
+        }
+        double seconds = chrono::duration<double>(Clock::now() - start).count();
+        writeWeights(outputPath, net);
+        cout << "Epoch " << setw(3) << epoch << ": loss " << fixed << setprecision(6) << loss / seen << ", " << seen
+             << " positions in " << setprecision(1) << seconds << " s (" << static_cast<long>(seen / seconds)
+             << " positions/s), weights written to " << outputPath << endl;
+    }
+    return 0;
+}
@@ -1,10 +1,12 @@
 import csv
+import sys
 import torch
 import torch.nn as nn
 import torch.optim as optim
 from torch.utils.data import Dataset, DataLoader
 from fen_to_input import fen_to_input
 from nnue_model import NNUE
+from dataset_loader import BinaryDataset, dense_inputs
 
 class ChessDataset(Dataset):
     def __init__(self, csv_path):
@@ -37,9 +39,29 @@ def train(model, dataloader, optimizer, criterion, device):
         total_loss += loss.item()
     return total_loss / len(dataloader)
 
+# Same loop over packed positions (datagen output) decoded by the native loader
+def train_binary(model, dataset, optimizer, criterion, device):
+    model.train()
+    total_loss, batches = 0, 0
+    for indices, values, scores, results in dataset:
+        batch_x = dense_inputs(indices, values, len(scores)).to(device)
+        batch_y = scores.to(device)
+        optimizer.zero_grad()
+        preds = model(batch_x)
+        loss = criterion(preds, batch_y)
+        loss.backward()
+        optimizer.step()
+        total_loss += loss.item()
+        batches += 1
+    return total_loss / max(1, batches)
+
 if __name__ == "__main__":
-    dataset = ChessDataset("train_data.csv")
-    dataloader = DataLoader(dataset, batch_size=64, shuffle=True)
+    path = sys.argv[1] if len(sys.argv) > 1 else "train_data.csv"
+    if path.endswith(".bin"):
+        dataloader = BinaryDataset(path, batch_size=64)
+    else:
+        dataset = ChessDataset(path)
+        dataloader = DataLoader(dataset, batch_size=64, shuffle=True)
 
     device = torch.device("cuda" if torch.cuda.is_available() else "cpu")
     model = NNUE().to(device)
@@ -47,7 +69,10 @@ if __name__ == "__main__":
     criterion = nn.MSELoss()
 
     for epoch in range(100):  # Try more epochs later
-        loss = train(model, dataloader, optimizer, criterion, device)
+        if isinstance(dataloader, BinaryDataset):
+            loss = train_binary(model, dataloader, optimizer, criterion, device)
+        else:
+            loss = train(model, dataloader, optimizer, criterion, device)
         print(f"Epoch {epoch+1}, Loss: {loss:.4f}")
 
 torch.save(model.state_dict(), "trained_model.pt")
\ No newline at end of file
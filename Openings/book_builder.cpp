@@ -0,0 +1,506 @@
+// Opening book builder: replays PGN collections and writes the engine's openings.db.
+//
+// Build:  g++ -std=c++17 -O3 -march=native -pthread -o book_builder book_builder.cpp -lsqlite3
+// Usage:  ./book_builder [-o openings.db] [-t threads] [--max-ply N] [--min-games N] games1.pgn [games2.pgn ...]
+//         ./book_builder --migrate openings.db   (adds the hash column to a book from older tools)
+//
+// A reader thread streams the PGN files and cuts them into batches of games, worker threads replay
+// the batches and aggregate per-position move statistics into sharded hash maps, and the result is
+// pruned by frequency and depth and written to the `nodes` table read by the engine, keyed by
+// Zobrist hash (indexed `hash` column) as well as by FEN.
+
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <unordered_map>
+#include <fstream>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <sqlite3.h>
+#include <unistd.h>
+
+#include "../../chess-library/include/chess.hpp"
+
+using namespace chess;
+using namespace std;
+using Clock = std::chrono::steady_clock;
+
+// Configuration values (overridable from the command line)
+int MAX_PLY = 24;           // Deepest ply (half move) stored in the book
+int MIN_GAMES = 5;          // Positions and moves seen fewer times than this are pruned
+int NUM_THREADS = max(1u, thread::hardware_concurrency());
+constexpr int BATCH_GAMES = 512;   // Games handed to a worker at once
+constexpr int NUM_SHARDS = 64;     // Independent locks on the position table
+
+//-------------------------------------------------------------
+// Aggregated statistics
+//-------------------------------------------------------------
+
+struct MoveStats {
+    uint16_t move;
+    uint32_t wins = 0;     // From the point of view of the side that played the move
+    uint32_t draws = 0;
+    uint32_t losses = 0;
+    uint32_t games() const { return wins + draws + losses; }
+};
+
+struct PositionStats {
+    string fen;            // FEN of the shallowest occurrence
+    uint16_t ply = 0xFFFF;
+    uint32_t games = 0;
+    vector<MoveStats> moves;
+};
+
+// Position table split in shards so workers rarely wait on each other.
+struct Shard {
+    mutex lock;
+    unordered_map<uint64_t, PositionStats> positions;
+};
+Shard shards[NUM_SHARDS];
+
+// One (position, move) observation produced while replaying a game.
+struct Sample {
+    uint64_t key;
+    uint16_t move;
+    uint16_t ply;
+    int8_t score;          // +1 win, 0 draw, -1 loss for the side to move
+    string fen;            // Only filled the first time a worker sees the key
+};
+
+//-------------------------------------------------------------
+// Game batches: the reader produces them, the workers consume them
+//-------------------------------------------------------------
+
+class BatchQueue {
+public:
+    void push(vector<string>&& batch) {
+        unique_lock<mutex> guard(lock);
+        not_full.wait(guard, [&] { return batches.size() < 4 * (size_t)NUM_THREADS; });
+        batches.push_back(std::move(batch));
+        not_empty.notify_one();
+    }
+
+    bool pop(vector<string>& batch) {
+        unique_lock<mutex> guard(lock);
+        not_empty.wait(guard, [&] { return !batches.empty() || finished; });
+        if (batches.empty()) return false;
+        batch = std::move(batches.front());
+        batches.pop_front();
+        not_full.notify_one();
+        return true;
+    }
+
+    void close() {
+        lock_guard<mutex> guard(lock);
+        finished = true;
+        not_empty.notify_all();
+    }
+
+private:
+    mutex lock;
+    condition_variable not_empty, not_full;
+    deque<vector<string>> batches;
+    bool finished = false;
+};
+
+// Stream a PGN file and cut it into single games. A new game starts at the first header
+// line that follows movetext.
+void readPgnFile(const string& path, BatchQueue& queue, atomic<uint64_t>& bytesRead) {
+    ifstream in(path);
+    if (!in.is_open()) {
+        cerr << "Could not open " << path << endl;
+        return;
+    }
+
+    vector<string> batch;
+    batch.reserve(BATCH_GAMES);
+    string game, line;
+    bool inMoves = false;
+
+    while (getline(in, line)) {
+        bytesRead += line.size() + 1;
+        if (!line.empty() && line[0] == '[') {
+            if (inMoves) {
+                batch.push_back(std::move(game));
+                game.clear();
+                inMoves = false;
+                if (batch.size() == BATCH_GAMES) {
+                    queue.push(std::move(batch));
+                    batch = vector<string>();
+                    batch.reserve(BATCH_GAMES);
+                }
+            }
+        }
+        else if (!line.empty()) {
+            inMoves = true;
+        }
+        game += line;
+        game += '\n';
+    }
+    if (inMoves) batch.push_back(std::move(game));
+    if (!batch.empty()) queue.push(std::move(batch));
+}
+
+//-------------------------------------------------------------
+// Game replay
+//-------------------------------------------------------------
+
+class BookVisitor : public pgn::Visitor {
+public:
+    vector<Sample> samples;
+    uint64_t games = 0;
+    uint64_t badGames = 0;
+
+    void startPgn() override {
+        board = Board();
+        game.clear();
+        result = 0;
+        ply = 0;
+        valid = true;
+    }
+
+    void header(string_view key, string_view value) override {
+        if (key == "FEN") {
+            // Games from custom positions are not part of the opening tree
+            valid = false;
+            skipPgn(true);
+        }
+        else if (key == "Result") {
+            if (value == "1-0") result = 1;
+            else if (value == "0-1") result = -1;
+            else if (value == "1/2-1/2") result = 0;
+            else {
+                valid = false;   // Unfinished game, no outcome to learn from
+                skipPgn(true);
+            }
+        }
+    }
+
+    void startMoves() override {}
+
+    void move(string_view san, string_view) override {
+        if (!valid || ply >= MAX_PLY) return;
+
+        // Malformed or ambiguous SAN throws rather than returning NO_MOVE: either way the game
+        // is dropped, not the whole build
+        Move move;
+        try {
+            move = uci::parseSan(board, san);
+        } catch (const exception&) {
+            move = Move(Move::NO_MOVE);
+        }
+        if (move == Move::NO_MOVE) {
+            valid = false;
+            skipPgn(true);
+            return;
+        }
+
+        Sample sample;
+        sample.key = board.zobrist();
+        sample.move = move.move();
+        sample.ply = ply;
+        sample.score = 0;   // Filled in once the result is known
+        // Popular positions are seen over and over: only build a FEN when this worker has not
+        // recently sent one for the key at the same or a shallower ply.
+        SeenEntry& recent = seen[sample.key & (SEEN_SIZE - 1)];
+        if (recent.key != sample.key || recent.ply > ply) {
+            sample.fen = board.getFen();
+            recent = {sample.key, ply};
+        }
+        game.push_back(std::move(sample));
+
+        board.makeMove(move);
+        ++ply;
+        if (ply >= MAX_PLY) skipPgn(true);   // Nothing deeper is stored, skip the rest of the game
+    }
+
+    void endPgn() override {
+        if (!valid || game.empty()) {
+            // FENs built for a discarded game never reach the table: let the next game send them again
+            for (const auto& sample : game) {
+                SeenEntry& recent = seen[sample.key & (SEEN_SIZE - 1)];
+                if (!sample.fen.empty() && recent.key == sample.key) recent = SeenEntry();
+            }
+            ++badGames;
+            skipPgn(false);
+            return;
+        }
+        for (auto& sample : game) {
+            // White moves on even plies
+            sample.score = (sample.ply % 2 == 0) ? result : -result;
+            samples.push_back(std::move(sample));
+        }
+        ++games;
+        skipPgn(false);
+    }
+
+private:
+    struct SeenEntry {
+        uint64_t key = 0;
+        uint16_t ply = 0;
+    };
+    static constexpr size_t SEEN_SIZE = 1 << 20;
+    vector<SeenEntry> seen = vector<SeenEntry>(SEEN_SIZE);
+
+    Board board;
+    vector<Sample> game;
+    int result = 0;
+    uint16_t ply = 0;
+    bool valid = true;
+};
+
+// Merge a worker's samples into the shared table, taking each shard lock once.
+void flushSamples(vector<Sample>& samples) {
+    vector<vector<Sample*>> byShard(NUM_SHARDS);
+    for (auto& sample : samples)
+        byShard[sample.key % NUM_SHARDS].push_back(&sample);
+
+    for (int s = 0; s < NUM_SHARDS; ++s) {
+        if (byShard[s].empty()) continue;
+        lock_guard<mutex> guard(shards[s].lock);
+        auto& positions = shards[s].positions;
+        for (Sample* sample : byShard[s]) {
+            PositionStats& pos = positions[sample->key];
+            if (!sample->fen.empty() && (sample->ply < pos.ply || (sample->ply == pos.ply && sample->fen < pos.fen))) {
+                pos.fen = std::move(sample->fen);
+                pos.ply = sample->ply;
+            }
+            ++pos.games;
+
+            auto it = find_if(pos.moves.begin(), pos.moves.end(),
+                              [&](const MoveStats& m) { return m.move == sample->move; });
+            if (it == pos.moves.end()) {
+                pos.moves.push_back(MoveStats{sample->move});
+                it = pos.moves.end() - 1;
+            }
+            if (sample->score > 0) ++it->wins;
+            else if (sample->score < 0) ++it->losses;
+            else ++it->draws;
+        }
+    }
+    samples.clear();
+}
+
+void worker(BatchQueue& queue, atomic<uint64_t>& totalGames, atomic<uint64_t>& totalBad) {
+    BookVisitor visitor;
+    vector<string> batch;
+    while (queue.pop(batch)) {
+        for (const auto& game : batch) {
+            istringstream in(game);
+            pgn::StreamParser parser(in);
+            parser.readGames(visitor);
+        }
+        flushSamples(visitor.samples);
+        totalGames += visitor.games;
+        totalBad += visitor.badGames;
+        visitor.games = visitor.badGames = 0;
+    }
+}
+
+//-------------------------------------------------------------
+// Output
+//-------------------------------------------------------------
+
+// Convert a move's score rate into a centipawn-like evaluation for the side to move.
+// A small prior keeps moves with a handful of lucky games from dominating.
+int moveEvaluation(const MoveStats& m) {
+    double p = (m.wins + 0.5 * m.draws + 1.0) / (m.games() + 2.0);
+    return static_cast<int>(lround(400.0 * log10(p / (1.0 - p))));
+}
+
+// The book is built in a new file next to `path` and renamed over it only once every row is
+// committed and indexed, so a failed build leaves the previous book as it was.
+bool writeBook(const string& path, uint64_t& nodesWritten) {
+    string temporary = path + "." + to_string(getpid()) + ".tmp";
+    remove(temporary.c_str());
+    sqlite3* db = nullptr;
+    sqlite3_stmt* insert = nullptr;
+    auto fail = [&](const string& what) {
+        cerr << what << ": " << sqlite3_errmsg(db) << endl;
+        sqlite3_finalize(insert);
+        sqlite3_close(db);
+        remove(temporary.c_str());
+        return false;
+    };
+
+    if (sqlite3_open(temporary.c_str(), &db) != SQLITE_OK) return fail("Can't open " + temporary);
+
+    // Nothing to protect in a fresh file until the rename: no journal, no syncs
+    const char* schema =
+        "PRAGMA journal_mode = OFF;"
+        "PRAGMA synchronous = OFF;"
+        "CREATE TABLE nodes (id INTEGER PRIMARY KEY, fen TEXT, evaluation INTEGER, moves TEXT, pv TEXT, hash INTEGER);"
+        "BEGIN TRANSACTION;";
+    if (sqlite3_exec(db, schema, nullptr, nullptr, nullptr) != SQLITE_OK) return fail("Failed to create book schema");
+
+    if (sqlite3_prepare_v2(db, "INSERT INTO nodes (fen, evaluation, moves, pv, hash) VALUES (?, ?, ?, '', ?);", -1, &insert, nullptr) != SQLITE_OK)
+        return fail("Failed to prepare the insert");
+
+    nodesWritten = 0;
+    for (auto& shard : shards) {
+        for (auto& [key, pos] : shard.positions) {
+            if (pos.games < (uint32_t)MIN_GAMES || pos.ply >= MAX_PLY || pos.fen.empty()) continue;
+
+            vector<pair<int, uint16_t>> ranked;   // (evaluation, move)
+            for (const auto& m : pos.moves) {
+                if (m.games() < (uint32_t)MIN_GAMES) continue;
+                ranked.push_back({moveEvaluation(m), m.move});
+            }
+            if (ranked.empty()) continue;
+
+            // The engine treats the first entry as the best move
+            sort(ranked.begin(), ranked.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+            string moves;
+            for (const auto& [eval, move] : ranked) {
+                if (!moves.empty()) moves += ' ';
+                moves += uci::moveToUci(Move(move)) + ":" + to_string(eval);
+            }
+
+            if (sqlite3_bind_text(insert, 1, pos.fen.c_str(), -1, SQLITE_STATIC) != SQLITE_OK ||
+                sqlite3_bind_int(insert, 2, ranked[0].first) != SQLITE_OK ||
+                sqlite3_bind_text(insert, 3, moves.c_str(), -1, SQLITE_TRANSIENT) != SQLITE_OK ||
+                sqlite3_bind_int64(insert, 4, static_cast<sqlite3_int64>(key)) != SQLITE_OK ||
+                sqlite3_step(insert) != SQLITE_DONE || sqlite3_reset(insert) != SQLITE_OK)
+                return fail("Failed to insert " + pos.fen);
+            ++nodesWritten;
+        }
+    }
+    sqlite3_finalize(insert);
+    insert = nullptr;
+
+    if (sqlite3_exec(db, "COMMIT; CREATE INDEX nodes_fen ON nodes (fen); CREATE INDEX nodes_hash ON nodes (hash);",
+                     nullptr, nullptr, nullptr) != SQLITE_OK)
+        return fail("Failed to commit the book");
+    if (sqlite3_close(db) != SQLITE_OK) return fail("Failed to close " + temporary);
+    if (rename(temporary.c_str(), path.c_str()) != 0) {
+        cerr << "Could not replace " << path << ": " << strerror(errno) << endl;
+        remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Give a book written by older tools the indexed `hash` column the engine looks positions up
+// by. All in one transaction: on any failure the book is left as it was, and the engine,
+// which opens books read-only, keeps looking it up by FEN.
+bool migrateBook(const string& path) {
+    sqlite3* db = nullptr;
+    sqlite3_stmt* select = nullptr;
+    sqlite3_stmt* update = nullptr;
+    auto fail = [&](const string& what) {
+        cerr << what << ": " << sqlite3_errmsg(db) << endl;
+        sqlite3_finalize(select);
+        sqlite3_finalize(update);
+        sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+        sqlite3_close(db);
+        return false;
+    };
+    auto text = [](sqlite3_stmt* stmt, int col) {
+        const unsigned char* value = sqlite3_column_text(stmt, col);
+        return value ? string(reinterpret_cast<const char*>(value)) : string();
+    };
+
+    if (sqlite3_open_v2(path.c_str(), &db, SQLITE_OPEN_READWRITE, nullptr) != SQLITE_OK)
+        return fail("Can't open " + path);
+    if (sqlite3_exec(db, "BEGIN IMMEDIATE;", nullptr, nullptr, nullptr) != SQLITE_OK)
+        return fail("Can't lock " + path);
+
+    bool hasColumn = false;
+    if (sqlite3_prepare_v2(db, "PRAGMA table_info(nodes);", -1, &select, nullptr) != SQLITE_OK)
+        return fail("Can't read the nodes table");
+    int rc;
+    while ((rc = sqlite3_step(select)) == SQLITE_ROW)
+        if (text(select, 1) == "hash") hasColumn = true;
+    if (rc != SQLITE_DONE) return fail("Can't read the nodes table");
+    sqlite3_finalize(select);
+    select = nullptr;
+    if (!hasColumn && sqlite3_exec(db, "ALTER TABLE nodes ADD COLUMN hash INTEGER;", nullptr, nullptr, nullptr) != SQLITE_OK)
+        return fail("Can't add the hash column");
+
+    if (sqlite3_prepare_v2(db, "SELECT id, fen FROM nodes WHERE hash IS NULL;", -1, &select, nullptr) != SQLITE_OK ||
+        sqlite3_prepare_v2(db, "UPDATE nodes SET hash = ? WHERE id = ?;", -1, &update, nullptr) != SQLITE_OK)
+        return fail("Failed to prepare the migration");
+    uint64_t migrated = 0;
+    while ((rc = sqlite3_step(select)) == SQLITE_ROW) {
+        string fen = text(select, 1);
+        uint64_t key;
+        try {
+            key = Board(fen).zobrist();
+        } catch (const exception&) {
+            return fail("Invalid FEN in the book: " + fen);
+        }
+        if (sqlite3_bind_int64(update, 1, static_cast<sqlite3_int64>(key)) != SQLITE_OK ||
+            sqlite3_bind_int64(update, 2, sqlite3_column_int64(select, 0)) != SQLITE_OK ||
+            sqlite3_step(update) != SQLITE_DONE || sqlite3_reset(update) != SQLITE_OK)
+            return fail("Failed to store the key of " + fen);
+        ++migrated;
+    }
+    if (rc != SQLITE_DONE) return fail("Failed to read the book positions");
+    sqlite3_finalize(select);
+    sqlite3_finalize(update);
+    select = update = nullptr;
+
+    if (sqlite3_exec(db, "CREATE INDEX IF NOT EXISTS nodes_hash ON nodes (hash); COMMIT;", nullptr, nullptr, nullptr) != SQLITE_OK)
+        return fail("Failed to commit the migration");
+    if (sqlite3_close(db) != SQLITE_OK) return fail("Failed to close " + path);
+    cout << "Added hash keys to " << migrated << " book positions in " << path << endl;
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    string output = "openings.db";
+    vector<string> inputs;
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--migrate" && i + 1 < argc) return migrateBook(argv[++i]) ? 0 : 1;
+        if ((arg == "-o" || arg == "--output") && i + 1 < argc) output = argv[++i];
+        else if ((arg == "-t" || arg == "--threads") && i + 1 < argc) NUM_THREADS = max(1, stoi(argv[++i]));
+        else if (arg == "--max-ply" && i + 1 < argc) MAX_PLY = stoi(argv[++i]);
+        else if (arg == "--min-games" && i + 1 < argc) MIN_GAMES = max(1, stoi(argv[++i]));
+        else inputs.push_back(arg);
+    }
+    if (inputs.empty()) {
+        cerr << "Usage: " << argv[0] << " [-o openings.db] [-t threads] [--max-ply N] [--min-games N] games.pgn ..." << endl;
+        cerr << "       " << argv[0] << " --migrate openings.db" << endl;
+        return 1;
+    }
+
+    auto start = Clock::now();
+    BatchQueue queue;
+    atomic<uint64_t> totalGames{0}, totalBad{0}, bytesRead{0};
+
+    vector<thread> workers;
+    for (int i = 0; i < NUM_THREADS; ++i)
+        workers.emplace_back(worker, ref(queue), ref(totalGames), ref(totalBad));
+
+    for (const auto& path : inputs)
+        readPgnFile(path, queue, bytesRead);
+    queue.close();
+    for (auto& t : workers) t.join();
+
+    uint64_t positions = 0;
+    for (auto& shard : shards) positions += shard.positions.size();
+    double replaySeconds = chrono::duration<double>(Clock::now() - start).count();
+
+    cout << "Replayed " << totalGames << " games (" << totalBad << " skipped), "
+         << bytesRead / (1024 * 1024) << " MB, " << positions << " positions in "
+         << replaySeconds << "s (" << static_cast<uint64_t>(totalGames / max(replaySeconds, 1e-3)) << " games/s)" << endl;
+
+    uint64_t nodesWritten = 0;
+    if (!writeBook(output, nodesWritten)) return 1;
+
+    double totalSeconds = chrono::duration<double>(Clock::now() - start).count();
+    cout << "Wrote " << nodesWritten << " book positions to " << output << " in " << totalSeconds << "s total" << endl;
+    return 0;
+}